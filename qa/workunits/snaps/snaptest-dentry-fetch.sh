@@ -0,0 +1,51 @@
+#!/bin/sh -x
+
+expect_failure() {
+    if "$@" ; then
+	return 1
+    fi
+    return 0
+}
+set -e
+
+# a lookup that misses in an incomplete dirfrag reads only the head
+# key of the name.  the cached miss must not hide older versions of
+# the name that are still in a snapshot.
+
+ceph mds set allow_new_snaps true --yes-i-really-mean-it
+
+wait_for_active() {
+    while ! ceph mds stat | grep -q 'up:active' ; do
+	sleep 1
+    done
+}
+
+mkdir d
+for f in `seq 1 100` ; do
+    echo $f > d/f$f
+done
+mkdir d/.snap/s
+rm d/f1
+sync
+
+# restart the mds so that d is only loaded on demand
+ceph mds fail 0
+sleep 5
+wait_for_active
+ceph mds tell 0 injectargs '--mds_dir_fetch_dentry_min 1'
+
+# head miss: single dentry fetch, caches a null dentry
+expect_failure stat d/f1
+
+# the snapshotted version is still there, both on lookup and readdir
+grep 1 d/.snap/s/f1
+ls d/.snap/s | grep -x f1
+ls d/.snap/s | wc -l | grep -x 100
+if ls d | grep -x f1 ; then
+    exit 1
+fi
+
+rmdir d/.snap/s
+rm -r d
+
+echo OK
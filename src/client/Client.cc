@@ -171,6 +171,7 @@ Client::Client(Messenger *m, MonClient *mc)
     interrupt_finisher(m->cct),
     remount_finisher(m->cct),
     objecter_finisher(m->cct),
+    async_dirops_pending(0), async_dirop_stop(false),
     tick_event(NULL),
     monclient(mc), messenger(m), whoami(m->get_myname().num()),
     cap_epoch_barrier(0),
@@ -478,6 +479,13 @@ int Client::init()
   populate_metadata();
 
   client_lock.Lock();
+  if (cct->_conf->client_async_unlink) {
+    for (int i = 0; i < cct->_conf->client_async_dirop_threads; ++i) {
+      AsyncDiropThread *t = new AsyncDiropThread(this);
+      t->create();
+      async_dirop_threads.push_back(t);
+    }
+  }
   initialized = true;
   client_lock.Unlock();
   return r;
@@ -518,6 +526,21 @@ void Client::shutdown()
     remount_finisher.stop();
   }
 
+  if (!async_dirop_threads.empty()) {
+    ldout(cct, 10) << "shutdown stopping async dirop threads" << dendl;
+    client_lock.Lock();
+    async_dirop_stop = true;
+    async_dirop_cond.Signal();
+    client_lock.Unlock();
+    for (vector<AsyncDiropThread*>::iterator p = async_dirop_threads.begin();
+	 p != async_dirop_threads.end();
+	 ++p) {
+      (*p)->join();
+      delete *p;
+    }
+    async_dirop_threads.clear();
+  }
+
   objectcacher->stop();  // outside of client_lock! this does a join.
 
   client_lock.Lock();
@@ -1051,6 +1074,7 @@ void Client::insert_readdir_results(MetaRequest *request, MetaSession *session,
 	  dn = olddn;
 	  touch_dn(dn);
 	  dn->item_dentry_list.move_to_back();
+	  _readdir_cache_invalidate(dir);
 	}
       } else {
 	// new dn
@@ -1479,6 +1503,17 @@ int Client::make_request(MetaRequest *request,
   if (use_mds >= 0)
     request->resend_mds = use_mds;
 
+  // let background unlinks touching these inodes land first, so the
+  // mds sees ops in the order the application issued them
+  if (!request->async) {
+    while ((request->inode() && request->inode()->async_dirops > 0) ||
+	   (request->old_inode() && request->old_inode()->async_dirops > 0) ||
+	   (request->other_inode() && request->other_inode()->async_dirops > 0)) {
+      ldout(cct, 10) << "make_request tid " << tid << " waiting for async dirops" << dendl;
+      async_dirop_done_cond.Wait(client_lock);
+    }
+  }
+
   while (1) {
     if (request->aborted)
       break;
@@ -2535,6 +2570,7 @@ Dentry* Client::link(Dir *dir, const string& name, Inode *in, Dentry *dn)
     dn->dir = dir;
     dir->dentries[dn->name] = dn;
     dir->dentry_list.push_back(&dn->item_dentry_list);
+    _readdir_cache_invalidate(dir);
     lru.lru_insert_mid(dn);    // mid or top?
 
     ldout(cct, 15) << "link dir " << dir->parent_inode << " '" << name << "' to inode " << in
@@ -2543,6 +2579,7 @@ Dentry* Client::link(Dir *dir, const string& name, Inode *in, Dentry *dn)
     ldout(cct, 15) << "link dir " << dir->parent_inode << " '" << name << "' to inode " << in
 		   << " dn " << dn << " (old dn)" << dendl;
     dn->item_dentry_list.move_to_back();
+    _readdir_cache_invalidate(dir);
   }
 
   if (in) {    // link to inode
@@ -2602,6 +2639,7 @@ void Client::unlink(Dentry *dn, bool keepdir, bool keepdentry)
     // unlink from dir
     dn->dir->dentries.erase(dn->name);
     dn->item_dentry_list.remove_myself();
+    _readdir_cache_remove(dn);
     if (dn->dir->is_empty() && !keepdir)
       close_dir(dn->dir);
     dn->dir = 0;
@@ -4702,6 +4740,8 @@ void Client::unmount()
   ldout(cct, 2) << "unmounting" << dendl;
   unmounting = true;
 
+  _wait_async_dirops();
+
   while (!mds_requests.empty()) {
     ldout(cct, 10) << "waiting on " << mds_requests.size() << " requests" << dendl;
     mount_cond.Wait(client_lock);
@@ -5827,9 +5867,17 @@ int Client::closedir(dir_result_t *dir)
   tout(cct) << "closedir" << std::endl;
   tout(cct) << (unsigned long)dir << std::endl;
 
-  ldout(cct, 3) << "closedir(" << dir << ") = 0" << dendl;
+  int r = 0;
+  if (dir->inode) {
+    // surface errors from background unlinks in this directory
+    Inode *in = dir->inode;
+    _wait_async_dirops(in);
+    r = in->async_err;
+    in->async_err = 0;
+  }
+  ldout(cct, 3) << "closedir(" << dir << ") = " << r << dendl;
   _closedir(dir);
-  return 0;
+  return r;
 }
 
 void Client::_closedir(dir_result_t *dirp)
@@ -6028,6 +6076,58 @@ int Client::_readdir_get_frag(dir_result_t *dirp)
   return res;
 }
 
+/*
+ * (Re)build the snapshot of a complete and ordered directory, sorted
+ * in readdir order (see dir_result_t::fpos_cmp).  Fails if two dentries
+ * share a position, in which case we go back to the MDS.
+ */
+bool Client::_readdir_cache_build(Dir *dir)
+{
+  vector<pair<uint64_t, Dentry*> >& cache = dir->readdir_cache;
+  cache.clear();
+  cache.reserve(dir->dentries.size());
+  for (xlist<Dentry*>::iterator pd = dir->dentry_list.begin(); !pd.end(); ++pd)
+    cache.push_back(make_pair((*pd)->offset, *pd));
+  sort(cache.begin(), cache.end(), dir_result_t::fpos_less());
+  for (unsigned i = 1; i < cache.size(); ++i) {
+    if (dir_result_t::fpos_cmp(cache[i - 1].first, cache[i].first) == 0) {
+      ldout(cct, 10) << "_readdir_cache_build " << *dir->parent_inode
+		     << " duplicate offset at '" << cache[i].second->name
+		     << "'" << dendl;
+      cache.clear();
+      return false;
+    }
+  }
+  ldout(cct, 10) << "_readdir_cache_build " << *dir->parent_inode << " "
+		 << dir->readdir_cache.size() << " entries" << dendl;
+  dir->readdir_cache_valid = true;
+  return true;
+}
+
+void Client::_readdir_cache_invalidate(Dir *dir)
+{
+  if (dir->readdir_cache_valid) {
+    dir->readdir_cache_valid = false;
+    dir->readdir_cache.clear();
+  }
+}
+
+// punch a hole for a dentry that is going away, rather than
+// throwing out the whole snapshot.
+void Client::_readdir_cache_remove(Dentry *dn)
+{
+  Dir *dir = dn->dir;
+  if (!dir->readdir_cache_valid)
+    return;
+  vector<pair<uint64_t, Dentry*> >::iterator p =
+    lower_bound(dir->readdir_cache.begin(), dir->readdir_cache.end(),
+		make_pair(dn->offset, (Dentry*)NULL), dir_result_t::fpos_less());
+  if (p != dir->readdir_cache.end() && p->second == dn)
+    p->second = NULL;
+  else
+    _readdir_cache_invalidate(dir);
+}
+
 int Client::_readdir_cache_cb(dir_result_t *dirp, add_dirent_cb_t cb, void *p)
 {
   assert(client_lock.is_locked());
@@ -6042,19 +6142,30 @@ int Client::_readdir_cache_cb(dir_result_t *dirp, add_dirent_cb_t cb, void *p)
     return 0;
   }
 
-  xlist<Dentry*>::iterator pd = dir->dentry_list.begin();
+  if (!dir->readdir_cache_valid && !_readdir_cache_build(dir))
+    return -EAGAIN;
+
+  // seek
+  uint64_t seek = dirp->offset;
   if (dirp->at_cache_name.length()) {
     ceph::unordered_map<string,Dentry*>::iterator it = dir->dentries.find(dirp->at_cache_name);
     if (it == dir->dentries.end())
       return -EAGAIN;
-    Dentry *dn = it->second;
-    pd = xlist<Dentry*>::iterator(&dn->item_dentry_list);
-    ++pd;
+    seek = it->second->offset + 1;
   }
+  vector<pair<uint64_t, Dentry*> >& cache = dir->readdir_cache;
+  vector<pair<uint64_t, Dentry*> >::iterator pd = cache.begin();
+  if (seek > 2)
+    pd = lower_bound(cache.begin(), cache.end(),
+		     make_pair(seek, (Dentry*)NULL), dir_result_t::fpos_less());
 
   string prev_name;
-  while (!pd.end()) {
-    Dentry *dn = *pd;
+  while (pd != cache.end()) {
+    Dentry *dn = pd->second;
+    if (dn == NULL) {
+      ++pd;
+      continue;
+    }
     if (dn->inode == NULL) {
       ldout(cct, 15) << " skipping null '" << dn->name << "'" << dendl;
       ++pd;
@@ -6073,25 +6184,42 @@ int Client::_readdir_cache_cb(dir_result_t *dirp, add_dirent_cb_t cb, void *p)
       
     uint64_t next_off = dn->offset + 1;
     ++pd;
-    if (pd.end())
+    if (pd == cache.end())
       next_off = dir_result_t::END;
 
+    // the callback may drop client_lock, so remember where we were in
+    // case the snapshot is rebuilt underneath us.
+    string name = dn->name;
+    uint64_t off = dn->offset;
+
     client_lock.Unlock();
     int r = cb(p, &de, &st, stmask, next_off);  // _next_ offset
     client_lock.Lock();
-    ldout(cct, 15) << " de " << de.d_name << " off " << hex << dn->offset << dec
+    ldout(cct, 15) << " de " << de.d_name << " off " << hex << off << dec
 	     << " = " << r
 	     << dendl;
     if (r < 0) {
-      dirp->next_offset = dn->offset;
+      dirp->next_offset = off;
       dirp->at_cache_name = prev_name;
       return r;
     }
 
-    prev_name = dn->name;
+    prev_name = name;
     dirp->offset = next_off;
     if (r > 0)
       return r;
+
+    if (!dirp->inode->dir || dirp->inode->dir != dir ||
+	!dir->readdir_cache_valid) {
+      // raced with a change to the directory; pick up from the MDS
+      ldout(cct, 10) << " dir changed while unlocked, stopping at '" << name << "'" << dendl;
+      dirp->at_cache_name = name;
+      return -EAGAIN;
+    }
+    // the cache may have been rebuilt in the meantime; find our place
+    // again by offset rather than by position.
+    pd = lower_bound(cache.begin(), cache.end(),
+		     make_pair(off + 1, (Dentry*)NULL), dir_result_t::fpos_less());
   }
 
   ldout(cct, 10) << "_readdir_cache_cb " << dirp << " on " << dirp->inode->ino << " at end" << dendl;
@@ -6174,7 +6302,7 @@ int Client::readdir_r_cb(dir_result_t *d, add_dirent_cb_t cb, void *p)
 	   << dirp->inode->is_complete_and_ordered()
 	   << " issued " << ccap_string(dirp->inode->caps_issued())
 	   << dendl;
-  if ((dirp->offset == 2 || dirp->at_cache_name.length()) &&
+  if (dirp->offset >= 2 &&
       dirp->inode->snapid != CEPH_SNAPDIR &&
       dirp->inode->is_complete_and_ordered() &&
       dirp->inode->caps_issued_mask(CEPH_CAP_FILE_SHARED)) {
@@ -7083,22 +7211,16 @@ int Client::_read_async(Fh *f, uint64_t off, uint64_t len, bufferlist *bl)
   Context *onfinish = new C_SafeCond(&flock, &cond, &done, &rvalue);
   r = objectcacher->file_read(&in->oset, &in->layout, in->snapid,
 			      off, len, bl, 0, onfinish);
-  if (r == 0) {
-    get_cap_ref(in, CEPH_CAP_FILE_CACHE);
-    client_lock.Unlock();
-    flock.Lock();
-    while (!done)
-      cond.Wait(flock);
-    flock.Unlock();
-    client_lock.Lock();
-    put_cap_ref(in, CEPH_CAP_FILE_CACHE);
-    r = rvalue;
-  } else {
+  if (r != 0) {
     // it was cached.
     delete onfinish;
+    onfinish = NULL;
   }
 
-  if(conf->client_readahead_max_bytes > 0) {
+  // start readahead before we block on the demand read so the next
+  // objects are already in flight while this one completes
+  if (conf->client_readahead_max_bytes > 0 ||
+      conf->client_readahead_max_periods > 0) {
     pair<uint64_t, uint64_t> readahead_extent = f->readahead.update(off, len, in->size);
     if (readahead_extent.second > 0) {
       ldout(cct, 20) << "readahead " << readahead_extent.first << "~" << readahead_extent.second
@@ -7119,6 +7241,18 @@ int Client::_read_async(Fh *f, uint64_t off, uint64_t len, bufferlist *bl)
     }
   }
 
+  if (onfinish) {
+    get_cap_ref(in, CEPH_CAP_FILE_CACHE);
+    client_lock.Unlock();
+    flock.Lock();
+    while (!done)
+      cond.Wait(flock);
+    flock.Unlock();
+    client_lock.Lock();
+    put_cap_ref(in, CEPH_CAP_FILE_CACHE);
+    r = rvalue;
+  }
+
   return r;
 }
 
@@ -7575,6 +7709,9 @@ int Client::_fsync(Fh *f, bool syncdataonly)
 		  << cpp_strerror(-r) << dendl;
   }
 
+  if (in->is_dir())
+    _wait_async_dirops(in);
+
   if (in->async_err) {
     ldout(cct, 1) << "ino " << in->ino << " marked with error from background flush! "
 		  << cpp_strerror(in->async_err) << dendl;
@@ -8057,6 +8194,9 @@ int Client::_sync_fs()
 {
   ldout(cct, 10) << "_sync_fs" << dendl;
 
+  // wait for background dirops
+  _wait_async_dirops();
+
   // wait for unsafe mds requests
   // FIXME
   
@@ -9279,6 +9419,21 @@ int Client::_unlink(Inode *dir, const char *name, int uid, int gid)
 
   req->set_inode(dir);
 
+  if (_can_async_unlink(dir, de, otherin)) {
+    while (async_dirops_pending >= cct->_conf->client_async_dirops_max)
+      async_dirop_done_cond.Wait(client_lock);
+    // the wait dropped client_lock; the dentry may have changed and
+    // our dir caps may have been revoked in the meantime
+    if (_can_async_unlink(dir, de, otherin)) {
+      req->async = true;
+      unlink(de, true, true);  // keep dir and (null) dentry
+      _queue_async_dirop(req, dir, uid, gid);
+      trim_cache();
+      ldout(cct, 3) << "unlink(" << path << ") = 0 (async)" << dendl;
+      return 0;
+    }
+  }
+
   res = make_request(req, uid, gid);
 
   trim_cache();
@@ -9290,6 +9445,63 @@ int Client::_unlink(Inode *dir, const char *name, int uid, int gid)
   return res;
 }
 
+bool Client::_can_async_unlink(Inode *dir, Dentry *dn, Inode *in)
+{
+  if (async_dirop_threads.empty() || async_dirop_stop)
+    return false;
+  if (!in || in->is_dir() || dn->inode != in)
+    return false;
+  // we answer lookups in this dir from cache while the unlink is in
+  // flight, and the request must not drop our Fs on its way out
+  return dir->caps_issued_mask(CEPH_CAP_FILE_SHARED | CEPH_CAP_FILE_EXCL);
+}
+
+void Client::_queue_async_dirop(MetaRequest *req, Inode *dir, int uid, int gid)
+{
+  dir->get();
+  dir->async_dirops++;
+  async_dirops_pending++;
+  async_dirop_queue.push_back(AsyncDirop(req, dir, uid, gid));
+  async_dirop_cond.SignalOne();
+}
+
+void Client::_async_dirop_entry()
+{
+  Mutex::Locker lock(client_lock);
+  while (true) {
+    if (async_dirop_queue.empty()) {
+      if (async_dirop_stop)
+	break;
+      async_dirop_cond.Wait(client_lock);
+      continue;
+    }
+    AsyncDirop op = async_dirop_queue.front();
+    async_dirop_queue.pop_front();
+
+    int r = make_request(op.req, op.uid, op.gid);
+    ldout(cct, 10) << "async dirop on " << op.dir->ino << " = " << r << dendl;
+    if (r < 0) {
+      if (op.dir->async_err == 0)
+	op.dir->async_err = r;
+      // our local view of the dir is no longer trustworthy
+      op.dir->flags &= ~(I_COMPLETE | I_DIR_ORDERED);
+    }
+    op.dir->async_dirops--;
+    async_dirops_pending--;
+    put_inode(op.dir);
+    async_dirop_done_cond.Signal();
+  }
+}
+
+void Client::_wait_async_dirops(Inode *in)
+{
+  while (in ? in->async_dirops > 0 : async_dirops_pending > 0) {
+    ldout(cct, 10) << "waiting for " << (in ? in->async_dirops : async_dirops_pending)
+		   << " async dirops" << dendl;
+    async_dirop_done_cond.Wait(client_lock);
+  }
+}
+
 int Client::ll_unlink(Inode *in, const char *name, int uid, int gid)
 {
   Mutex::Locker lock(client_lock);
@@ -47,6 +47,7 @@ using std::fstream;
 #include "common/Mutex.h"
 #include "common/Timer.h"
 #include "common/Finisher.h"
+#include "common/Thread.h"
 
 #include "common/compiler_extensions.h"
 #include "common/cmdparse.h"
@@ -167,6 +168,26 @@ struct dir_result_t {
   static unsigned fpos_off(uint64_t p) {
     return p & MASK;
   }
+  /*
+   * order positions the way readdir visits them: frags in logical
+   * order, then by offset within the frag.  comparing the raw values
+   * does not work once frags of different depths are involved, since
+   * the frag's bit count sits in its top byte.
+   */
+  static int fpos_cmp(uint64_t l, uint64_t r) {
+    int c = ceph_frag_compare(fpos_frag(l), fpos_frag(r));
+    if (c)
+      return c;
+    if (fpos_off(l) != fpos_off(r))
+      return fpos_off(l) < fpos_off(r) ? -1 : 1;
+    return 0;
+  }
+  struct fpos_less {
+    bool operator()(const pair<uint64_t, Dentry*>& l,
+		    const pair<uint64_t, Dentry*>& r) const {
+      return fpos_cmp(l.first, r.first) < 0;
+    }
+  };
 
 
   Inode *inode;
@@ -251,6 +272,35 @@ class Client : public Dispatcher {
   Finisher remount_finisher;
   Finisher objecter_finisher;
 
+  // background directory ops (client_async_unlink)
+  struct AsyncDirop {
+    MetaRequest *req;
+    Inode *dir;
+    int uid, gid;
+    AsyncDirop(MetaRequest *r, Inode *d, int u, int g)
+      : req(r), dir(d), uid(u), gid(g) {}
+  };
+  class AsyncDiropThread : public Thread {
+    Client *client;
+  public:
+    AsyncDiropThread(Client *c) : client(c) {}
+    void *entry() {
+      client->_async_dirop_entry();
+      return NULL;
+    }
+  };
+  vector<AsyncDiropThread*> async_dirop_threads;
+  list<AsyncDirop> async_dirop_queue;
+  Cond async_dirop_cond;       // work queued, or stopping
+  Cond async_dirop_done_cond;  // a background op finished
+  int async_dirops_pending;    // queued + in flight
+  bool async_dirop_stop;
+
+  void _async_dirop_entry();
+  void _queue_async_dirop(MetaRequest *req, Inode *dir, int uid, int gid);
+  void _wait_async_dirops(Inode *in = NULL);
+  bool _can_async_unlink(Inode *dir, Dentry *dn, Inode *in);
+
   Context *tick_event;
   utime_t last_cap_renew;
   void renew_caps();
@@ -613,6 +663,9 @@ private:
   void _readdir_rechoose_frag(dir_result_t *dirp);
   int _readdir_get_frag(dir_result_t *dirp);
   int _readdir_cache_cb(dir_result_t *dirp, add_dirent_cb_t cb, void *p);
+  bool _readdir_cache_build(Dir *dir);
+  void _readdir_cache_invalidate(Dir *dir);
+  void _readdir_cache_remove(Dentry *dn);
   void _closedir(dir_result_t *dirp);
 
   // other helpers
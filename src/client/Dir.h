@@ -11,7 +11,14 @@ class Dir {
   uint64_t release_count;
   uint64_t ordered_count;
 
-  Dir(Inode* in) : release_count(0), ordered_count(0) { parent_inode = in; }
+  // dentry_list in readdir order, for serving readdir from cache.
+  // dentries removed from the dir leave a NULL hole until the next
+  // rebuild.
+  vector<pair<uint64_t, Dentry*> > readdir_cache;
+  bool readdir_cache_valid;
+
+  Dir(Inode* in) : release_count(0), ordered_count(0),
+		   readdir_cache_valid(false) { parent_inode = in; }
 
   bool is_empty() {  return dentries.empty(); }
 };
@@ -314,7 +314,7 @@ struct Inode {
       reported_size(0), wanted_max_size(0), requested_max_size(0),
       _ref(0), ll_ref(0), dir(0), dn_set(),
       fcntl_locks(NULL), flock_locks(NULL),
-      async_err(0)
+      async_err(0), async_dirops(0)
   {
     memset(&dir_layout, 0, sizeof(dir_layout));
     memset(&layout, 0, sizeof(layout));
@@ -359,6 +359,9 @@ struct Inode {
   // Record errors to be exposed in fclose/fflush
   int async_err;
 
+  // background directory ops (e.g. async unlink) still headed for the MDS
+  int async_dirops;
+
   void dump(Formatter *f) const;
 };
 
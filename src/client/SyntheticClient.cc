@@ -148,6 +148,10 @@ void parse_syn_options(vector<const char*>& args)
         syn_iargs.push_back( atoi(args[++i]) );
         syn_iargs.push_back( atoi(args[++i]) );
         syn_iargs.push_back( atoi(args[++i]) );
+      } else if (strcmp(args[i],"mdtest") == 0) {
+        syn_modes.push_back( SYNCLIENT_MODE_MDTEST );
+        syn_iargs.push_back( atoi(args[++i]) );
+        syn_iargs.push_back( atoi(args[++i]) );
       } else if (strcmp(args[i],"linktest") == 0) {
         syn_modes.push_back( SYNCLIENT_MODE_LINKTEST );
       } else if (strcmp(args[i],"createshared") == 0) {
@@ -571,6 +575,17 @@ int SyntheticClient::run()
 	did_run_me();
       }
       break;
+    case SYNCLIENT_MODE_MDTEST:
+      {
+        int files = iargs.front();  iargs.pop_front();
+        int iterations = iargs.front();  iargs.pop_front();
+        if (run_me()) {
+          dout(2) << "mdtest " << files << " " << iterations << dendl;
+          mdtest(files, iterations);
+        }
+	did_run_me();
+      }
+      break;
     case SYNCLIENT_MODE_CREATESHARED:
       {
         string sarg1 = get_sarg(0);
@@ -1877,6 +1892,62 @@ int SyntheticClient::make_files(int num, int count, int priv, bool more)
   return 0;
 }
 
+/*
+ * mdtest-like metadata benchmark: each client creates, stats and
+ * unlinks 'files' files in a private directory, and reports the
+ * per-phase op rate.  Run several clients (--num_client) against one
+ * MDS to measure how metadata throughput scales with client count.
+ */
+int SyntheticClient::mdtest(int files, int iterations)
+{
+  int whoami = client->get_nodeid().v;
+  char d[255];
+  char f[255];
+  struct stat st;
+
+  const char *phase_name[3] = { "create", "stat", "unlink" };
+  double phase_time[3] = { 0, 0, 0 };
+
+  for (int it = 0; it < iterations; it++) {
+    snprintf(d, sizeof(d), "mdtest.client%d.%d", whoami, it);
+    int r = client->mkdir(d, 0755);
+    if (r < 0 && r != -EEXIST) {
+      dout(0) << "mdtest mkdir " << d << " failed: " << cpp_strerror(r) << dendl;
+      return r;
+    }
+
+    for (int phase = 0; phase < 3; phase++) {
+      utime_t start = ceph_clock_now(client->cct);
+      for (int n = 0; n < files; n++) {
+        snprintf(f, sizeof(f), "%s/file.%d", d, n);
+        switch (phase) {
+        case 0: r = client->mknod(f, 0644); break;
+        case 1: r = client->lstat(f, &st); break;
+        case 2: r = client->unlink(f); break;
+        }
+        if (r < 0)
+          dout(1) << "mdtest " << phase_name[phase] << " " << f
+                  << " failed: " << cpp_strerror(r) << dendl;
+        if (time_to_stop()) return 0;
+      }
+      utime_t lat = ceph_clock_now(client->cct);
+      lat -= start;
+      phase_time[phase] += (double)lat;
+    }
+
+    client->rmdir(d);
+  }
+
+  for (int phase = 0; phase < 3; phase++) {
+    double ops = (double)files * iterations;
+    dout(0) << "mdtest " << phase_name[phase] << " " << ops << " ops in "
+            << phase_time[phase] << " sec, "
+            << (phase_time[phase] > 0 ? ops / phase_time[phase] : 0)
+            << " ops/sec" << dendl;
+  }
+  return 0;
+}
+
 int SyntheticClient::link_test()
 {
   char d[255];
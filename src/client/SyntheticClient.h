@@ -38,6 +38,7 @@
 #define SYNCLIENT_MODE_MAKEFILES2   12     // num count private
 #define SYNCLIENT_MODE_CREATESHARED 13     // num
 #define SYNCLIENT_MODE_OPENSHARED   14     // num count
+#define SYNCLIENT_MODE_MDTEST       15     // files iterations
 
 #define SYNCLIENT_MODE_RMFILE      19
 #define SYNCLIENT_MODE_WRITEFILE   20
@@ -232,6 +233,7 @@ class SyntheticClient {
   int stat_dirs(const char *basedir, int dirs, int files, int depth);
   int read_dirs(const char *basedir, int dirs, int files, int depth);
   int make_files(int num, int count, int priv, bool more);
+  int mdtest(int files, int iterations);
   int link_test();
 
   int create_shared(int num);
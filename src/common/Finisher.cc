@@ -9,82 +9,170 @@
 #undef dout_prefix
 #define dout_prefix *_dout << "finisher(" << this << ") "
 
+void Finisher::_init(int num_threads)
+{
+  if (num_threads < 1)
+    num_threads = 1;
+  for (int i = 0; i < num_threads; ++i)
+    finisher_threads.push_back(new FinisherThread(this));
+}
+
+Finisher::~Finisher()
+{
+  for (vector<FinisherThread*>::iterator p = finisher_threads.begin();
+       p != finisher_threads.end();
+       ++p) {
+    // contexts queued after stop() are dropped, as they always were;
+    // only free our wrappers around them.
+    Item *i = (*p)->submitted;
+    while (i) {
+      Item *next = i->next;
+      delete i;
+      i = next;
+    }
+    delete *p;
+  }
+  if (logger && cct) {
+    cct->get_perfcounters_collection()->remove(logger);
+    delete logger;
+  }
+}
+
+Finisher::Item *Finisher::_new_item(Context *c, int r)
+{
+  Item *i = new Item(c, r);
+  if (logger)
+    i->stamp = ceph_clock_now(cct);
+  return i;
+}
+
+/**
+ * push a chain of items, newest first, onto a thread's list
+ */
+void Finisher::_push(FinisherThread *t, Item *first, Item *last, int n)
+{
+  // count the items before the worker can see (and uncount) them
+  if (logger)
+    logger->inc(l_finisher_queue_len, n);
+  Item *head;
+  do {
+    head = t->submitted;
+    last->next = head;
+  } while (!__sync_bool_compare_and_swap(&t->submitted, head, first));
+
+  // the compare-and-swap is a full barrier, so either we see the thread
+  // going to sleep here, or it sees our items before it sleeps.
+  if (t->sleeping) {
+    t->lock.Lock();
+    t->cond.Signal();
+    t->lock.Unlock();
+  }
+}
+
 void Finisher::start()
 {
   ldout(cct, 10) << __func__ << dendl;
-  finisher_thread.create();
+  for (vector<FinisherThread*>::iterator p = finisher_threads.begin();
+       p != finisher_threads.end();
+       ++p)
+    (*p)->create();
 }
 
 void Finisher::stop()
 {
   ldout(cct, 10) << __func__ << dendl;
-  finisher_lock.Lock();
-  finisher_stop = true;
-  finisher_cond.Signal();
-  finisher_lock.Unlock();
-  finisher_thread.join();
+  for (vector<FinisherThread*>::iterator p = finisher_threads.begin();
+       p != finisher_threads.end();
+       ++p) {
+    (*p)->lock.Lock();
+    (*p)->stop = true;
+    (*p)->cond.Signal();
+    (*p)->lock.Unlock();
+  }
+  for (vector<FinisherThread*>::iterator p = finisher_threads.begin();
+       p != finisher_threads.end();
+       ++p)
+    (*p)->join();
   ldout(cct, 10) << __func__ << " finish" << dendl;
 }
 
 void Finisher::wait_for_empty()
 {
-  finisher_lock.Lock();
-  while (!finisher_queue.empty() || finisher_running) {
-    ldout(cct, 10) << "wait_for_empty waiting" << dendl;
-    finisher_empty_cond.Wait(finisher_lock);
+  for (vector<FinisherThread*>::iterator p = finisher_threads.begin();
+       p != finisher_threads.end();
+       ++p) {
+    FinisherThread *t = *p;
+    t->lock.Lock();
+    while (t->submitted || t->running) {
+      ldout(cct, 10) << "wait_for_empty waiting" << dendl;
+      t->empty_cond.Wait(t->lock);
+    }
+    t->lock.Unlock();
   }
   ldout(cct, 10) << "wait_for_empty empty" << dendl;
-  finisher_lock.Unlock();
 }
 
-void *Finisher::finisher_thread_entry()
+void *Finisher::finisher_thread_entry(FinisherThread *t)
 {
-  finisher_lock.Lock();
+  t->lock.Lock();
   ldout(cct, 10) << "finisher_thread start" << dendl;
 
-  while (!finisher_stop) {
-    while (!finisher_queue.empty()) {
-      vector<Context*> ls;
-      list<pair<Context*,int> > ls_rval;
-      ls.swap(finisher_queue);
-      ls_rval.swap(finisher_queue_rval);
-      finisher_running = true;
-      finisher_lock.Unlock();
-      ldout(cct, 10) << "finisher_thread doing " << ls << dendl;
-
-      for (vector<Context*>::iterator p = ls.begin();
-	   p != ls.end();
-	   ++p) {
-	if (*p) {
-	  (*p)->complete(0);
-	} else {
-	  assert(!ls_rval.empty());
-	  Context *c = ls_rval.front().first;
-	  c->complete(ls_rval.front().second);
-	  ls_rval.pop_front();
-	}
+  while (true) {
+    Item *head = __sync_lock_test_and_set(&t->submitted, (Item *)NULL);
+    if (head) {
+      t->running = true;
+      t->lock.Unlock();
+
+      // the list is newest first; reverse it
+      Item *ls = NULL;
+      int n = 0;
+      while (head) {
+	Item *next = head->next;
+	head->next = ls;
+	ls = head;
+	head = next;
+	++n;
+      }
+      ldout(cct, 10) << "finisher_thread doing " << n << " contexts" << dendl;
+
+      utime_t now;
+      if (logger)
+	now = ceph_clock_now(cct);
+      while (ls) {
+	Item *i = ls;
+	ls = i->next;
+	if (logger)
+	  logger->tinc(l_finisher_queue_lat, now - i->stamp);
+	if (i->c)
+	  i->c->complete(i->r);
 	if (logger)
 	  logger->dec(l_finisher_queue_len);
+	delete i;
       }
-      ldout(cct, 10) << "finisher_thread done with " << ls << dendl;
-      ls.clear();
+      ldout(cct, 10) << "finisher_thread done with " << n << " contexts"
+		     << dendl;
 
-      finisher_lock.Lock();
-      finisher_running = false;
+      t->lock.Lock();
+      t->running = false;
+      continue;
     }
+
     ldout(cct, 10) << "finisher_thread empty" << dendl;
-    finisher_empty_cond.Signal();
-    if (finisher_stop)
+    t->empty_cond.SignalAll();
+    if (t->stop)
       break;
-    
+
     ldout(cct, 10) << "finisher_thread sleeping" << dendl;
-    finisher_cond.Wait(finisher_lock);
+    t->sleeping = 1;
+    __sync_synchronize();
+    if (!t->submitted)
+      t->cond.Wait(t->lock);
+    t->sleeping = 0;
   }
-  finisher_empty_cond.Signal();
+  t->empty_cond.SignalAll();
 
   ldout(cct, 10) << "finisher_thread stop" << dendl;
-  finisher_stop = false;
-  finisher_lock.Unlock();
+  t->stop = false;
+  t->lock.Unlock();
   return 0;
 }
-
@@ -26,73 +26,109 @@ class CephContext;
 enum {
   l_finisher_first = 997082,
   l_finisher_queue_len,
+  l_finisher_queue_lat,
   l_finisher_last
 };
 
+/*
+ * Finisher completes queued Contexts in one or more threads.
+ *
+ * Contexts are pushed onto a per-thread lock-free list, and the
+ * finisher thread takes the whole list at once.  A queue only takes the
+ * lock to wake the thread if it is sleeping.
+ *
+ * With a single thread (the default), Contexts complete in the order
+ * they were queued.  With more threads, Contexts queued with
+ * queue_ordered() and the same key complete in order on one thread;
+ * the rest are spread over all threads and may complete in any order.
+ */
 class Finisher {
   CephContext *cct;
-  Mutex          finisher_lock;
-  Cond           finisher_cond, finisher_empty_cond;
-  bool           finisher_stop, finisher_running;
-  vector<Context*> finisher_queue;
-  list<pair<Context*,int> > finisher_queue_rval;
   PerfCounters *logger;
-  
-  void *finisher_thread_entry();
+
+  /// a queued Context
+  struct Item {
+    Context *c;
+    int r;
+    utime_t stamp;
+    Item *next;
+    Item(Context *c, int r) : c(c), r(r), next(NULL) {}
+  };
 
   struct FinisherThread : public Thread {
-    Finisher *fin;    
-    FinisherThread(Finisher *f) : fin(f) {}
-    void* entry() { return (void*)fin->finisher_thread_entry(); }
-  } finisher_thread;
+    Finisher *fin;
+    Item *submitted;       ///< pushed by queue(), newest first
+    Mutex lock;
+    Cond cond, empty_cond;
+    int sleeping;          ///< thread is (about to be) waiting on cond
+    bool stop, running;
+    FinisherThread(Finisher *f)
+      : fin(f), submitted(NULL), lock("Finisher::finisher_lock"),
+	sleeping(0), stop(false), running(false) {}
+    void* entry() { return (void*)fin->finisher_thread_entry(this); }
+  };
+  vector<FinisherThread*> finisher_threads;
+  atomic_t next_thread;
+
+  void *finisher_thread_entry(FinisherThread *t);
+
+  FinisherThread *_pick_thread() {
+    if (finisher_threads.size() == 1)
+      return finisher_threads[0];
+    return finisher_threads[next_thread.inc() % finisher_threads.size()];
+  }
+  FinisherThread *_pick_thread(uint64_t key) {
+    key ^= key >> 33;
+    key *= 0xff51afd7ed558ccdull;
+    key ^= key >> 33;
+    return finisher_threads[key % finisher_threads.size()];
+  }
+  Item *_new_item(Context *c, int r);
+  void _push(FinisherThread *t, Item *first, Item *last, int n);
+
+  template <typename T>
+  void _queue(FinisherThread *t, T& ls) {
+    if (ls.empty())
+      return;
+    Item *first = NULL, *last = NULL;
+    int n = 0;
+    for (typename T::iterator p = ls.begin(); p != ls.end(); ++p) {
+      // the pushed chain is newest first
+      Item *i = _new_item(*p, 0);
+      i->next = first;
+      first = i;
+      if (!last)
+	last = i;
+      ++n;
+    }
+    _push(t, first, last, n);
+    ls.clear();
+  }
+
+  void _init(int num_threads);
 
  public:
   void queue(Context *c, int r = 0) {
-    finisher_lock.Lock();
-    if (finisher_queue.empty()) {
-      finisher_cond.Signal();
-    }
-    if (r) {
-      finisher_queue_rval.push_back(pair<Context*, int>(c, r));
-      finisher_queue.push_back(NULL);
-    } else
-      finisher_queue.push_back(c);
-    if (logger)
-      logger->inc(l_finisher_queue_len);
-    finisher_lock.Unlock();
+    Item *i = _new_item(c, r);
+    _push(_pick_thread(), i, i, 1);
   }
   void queue(vector<Context*>& ls) {
-    finisher_lock.Lock();
-    if (finisher_queue.empty()) {
-      finisher_cond.Signal();
-    }
-    finisher_queue.insert(finisher_queue.end(), ls.begin(), ls.end());
-    if (logger)
-      logger->inc(l_finisher_queue_len, ls.size());
-    finisher_lock.Unlock();
-    ls.clear();
+    _queue(_pick_thread(), ls);
   }
   void queue(deque<Context*>& ls) {
-    finisher_lock.Lock();
-    if (finisher_queue.empty()) {
-      finisher_cond.Signal();
-    }
-    finisher_queue.insert(finisher_queue.end(), ls.begin(), ls.end());
-    if (logger)
-      logger->inc(l_finisher_queue_len, ls.size());
-    finisher_lock.Unlock();
-    ls.clear();
+    _queue(_pick_thread(), ls);
   }
   void queue(list<Context*>& ls) {
-    finisher_lock.Lock();
-    if (finisher_queue.empty()) {
-      finisher_cond.Signal();
-    }
-    finisher_queue.insert(finisher_queue.end(), ls.begin(), ls.end());
-    if (logger)
-      logger->inc(l_finisher_queue_len, ls.size());
-    finisher_lock.Unlock();
-    ls.clear();
+    _queue(_pick_thread(), ls);
+  }
+
+  /// complete in order with other Contexts queued with the same key
+  void queue_ordered(uint64_t key, Context *c, int r = 0) {
+    Item *i = _new_item(c, r);
+    _push(_pick_thread(key), i, i, 1);
+  }
+  void queue_ordered(uint64_t key, list<Context*>& ls) {
+    _queue(_pick_thread(key), ls);
   }
   
   void start();
@@ -101,29 +137,22 @@ class Finisher {
   void wait_for_empty();
 
   Finisher(CephContext *cct_) :
-    cct(cct_), finisher_lock("Finisher::finisher_lock"),
-    finisher_stop(false), finisher_running(false),
-    logger(0),
-    finisher_thread(this) {}
-  Finisher(CephContext *cct_, string name) :
-    cct(cct_), finisher_lock("Finisher::finisher_lock"),
-    finisher_stop(false), finisher_running(false),
-    logger(0),
-    finisher_thread(this) {
+    cct(cct_), logger(0) {
+    _init(1);
+  }
+  Finisher(CephContext *cct_, string name, int num_threads = 1) :
+    cct(cct_), logger(0) {
+    _init(num_threads);
     PerfCountersBuilder b(cct, string("finisher-") + name,
 			  l_finisher_first, l_finisher_last);
     b.add_u64(l_finisher_queue_len, "queue_len");
+    b.add_time_avg(l_finisher_queue_lat, "queue_latency");
     logger = b.create_perf_counters();
     cct->get_perfcounters_collection()->add(logger);
     logger->set(l_finisher_queue_len, 0);
   }
 
-  ~Finisher() {
-    if (logger && cct) {
-      cct->get_perfcounters_collection()->remove(logger);
-      delete logger;
-    }
-  }
+  ~Finisher();
 };
 
 class C_OnFinisher : public Context {
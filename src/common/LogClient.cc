@@ -90,7 +90,9 @@ static ostream& _prefix(std::ostream *_dout, LogChannel *lc) {
 
 LogChannel::LogChannel(CephContext *cct, LogClient *lc, const string &channel)
   : cct(cct), parent(lc), channel_lock("LogChannel::channel_lock"),
-    log_channel(channel), log_to_syslog(false), log_to_monitors(false)
+    log_channel(channel), log_to_syslog(false), log_to_monitors(false),
+    rate_window_count(0), rate_suppressed(0),
+    last_prio(CLOG_UNKNOWN), last_repeats(0)
 {
 }
 
@@ -99,14 +101,17 @@ LogChannel::LogChannel(CephContext *cct, LogClient *lc,
                        const string &prio)
   : cct(cct), parent(lc), channel_lock("LogChannel::channel_lock"),
     log_channel(channel), log_prio(prio), syslog_facility(facility),
-    log_to_syslog(false), log_to_monitors(false)
+    log_to_syslog(false), log_to_monitors(false),
+    rate_window_count(0), rate_suppressed(0),
+    last_prio(CLOG_UNKNOWN), last_repeats(0)
 {
 }
 
 LogClient::LogClient(CephContext *cct, Messenger *m, MonMap *mm,
 		     enum logclient_flag_t flags)
   : cct(cct), messenger(m), monmap(mm), is_mon(flags & FLAG_MON),
-    log_lock("LogClient::log_lock"), last_log_sent(0), last_log(0)
+    log_lock("LogClient::log_lock"), last_log_sent(0), last_log(0),
+    channels_lock("LogClient::channels_lock")
 {
 }
 
@@ -184,19 +189,105 @@ void LogChannel::do_log(clog_type prio, const std::string& s)
   }
 
   // log to monitor?
-  if (log_to_monitors) {
+  if (log_to_monitors && _should_send_to_monitors(e)) {
     parent->queue(e);
   }
 }
 
+void LogChannel::flush_repeats()
+{
+  Mutex::Locker l(channel_lock);
+  if (!last_repeats)
+    return;
+  utime_t now = ceph_clock_now(cct);
+  if ((double)(now - last_stamp) < cct->_conf->clog_dedup_interval)
+    return;
+  _queue_repeats();
+}
+
+void LogChannel::_queue_repeats()
+{
+  ostringstream ss;
+  ss << "last message repeated " << last_repeats << " times: " << last_msg;
+  _queue_notice(last_prio, ss.str(), last_stamp);
+  last_repeats = 0;
+}
+
+void LogChannel::_queue_notice(clog_type prio, const std::string& s,
+			       utime_t stamp)
+{
+  LogEntry e;
+  e.stamp = stamp;
+  e.prio = prio;
+  e.msg = s;
+  e.channel = get_log_channel();
+  parent->queue(e);
+}
+
+bool LogChannel::_should_send_to_monitors(const LogEntry& e)
+{
+  assert(channel_lock.is_locked());
+
+  // collapse repeats of the same entry into a single count
+  double dedup = cct->_conf->clog_dedup_interval;
+  if (dedup > 0) {
+    if (e.prio == last_prio && e.msg == last_msg &&
+	(double)(e.stamp - last_stamp) < dedup) {
+      ++last_repeats;
+      return false;
+    }
+    if (last_repeats)
+      _queue_repeats();
+    last_msg = e.msg;
+    last_prio = e.prio;
+    last_stamp = e.stamp;
+  }
+
+  // errors and security events are never dropped
+  int limit = cct->_conf->clog_rate_limit;
+  if (limit > 0 && e.prio != CLOG_ERROR && e.prio != CLOG_SEC) {
+    if ((double)(e.stamp - rate_window_start) >= 1.0) {
+      if (rate_suppressed) {
+	ostringstream ss;
+	ss << rate_suppressed << " log entries suppressed (clog_rate_limit "
+	   << limit << "/s)";
+	_queue_notice(CLOG_WARN, ss.str(), e.stamp);
+      }
+      rate_window_start = e.stamp;
+      rate_window_count = 0;
+      rate_suppressed = 0;
+    }
+    if (rate_window_count >= limit) {
+      ++rate_suppressed;
+      return false;
+    }
+    ++rate_window_count;
+  }
+  return true;
+}
+
 void LogClient::reset_session()
 {
   Mutex::Locker l(log_lock);
   last_log_sent = last_log - log_queue.size();
 }
 
+/*
+ * repeats of a channel's last entry are only counted until a different
+ * entry comes along; make sure the count still goes out if none does.
+ */
+void LogClient::flush_repeats()
+{
+  Mutex::Locker l(channels_lock);
+  for (map<string, LogChannelRef>::iterator p = channels.begin();
+       p != channels.end();
+       ++p)
+    p->second->flush_repeats();
+}
+
 Message *LogClient::get_mon_log_message()
 {
+  flush_repeats();
   Mutex::Locker l(log_lock);
   return _get_mon_log_message();
 }
@@ -152,6 +152,9 @@ public:
   void do_log(clog_type prio, std::stringstream& ss);
   void do_log(clog_type prio, const std::string& s);
 
+  /// send the repeat count of the last entry once clog_dedup_interval is up
+  void flush_repeats();
+
 private:
   CephContext *cct;
   LogClient *parent;
@@ -162,6 +165,21 @@ private:
   bool log_to_syslog;
   bool log_to_monitors;
 
+  // clog_rate_limit: entries sent in the current one second window
+  utime_t rate_window_start;
+  int rate_window_count;
+  unsigned rate_suppressed;
+
+  // clog_dedup_interval: last entry sent and how often it repeated since
+  std::string last_msg;
+  clog_type last_prio;
+  utime_t last_stamp;
+  unsigned last_repeats;
+
+  bool _should_send_to_monitors(const LogEntry& e);
+  void _queue_repeats();
+  void _queue_notice(clog_type prio, const std::string& s, utime_t stamp);
+
 
   friend class LogClientTemp;
 };
@@ -184,6 +202,7 @@ public:
 
   bool handle_log_ack(MLogAck *m);
   void reset_session();
+  void flush_repeats();
   Message *get_mon_log_message();
   bool are_pending();
 
@@ -192,6 +211,7 @@ public:
   }
 
   LogChannelRef create_channel(const std::string& name) {
+    Mutex::Locker l(channels_lock);
     LogChannelRef c;
     if (channels.count(name))
       c = channels[name];
@@ -203,11 +223,13 @@ public:
   }
 
   void destroy_channel(const std::string& name) {
+    Mutex::Locker l(channels_lock);
     if (channels.count(name))
       channels.erase(name);
   }
 
   void shutdown() {
+    Mutex::Locker l(channels_lock);
     channels.clear();
   }
   
@@ -226,6 +248,7 @@ private:
   version_t last_log;
   std::deque<LogEntry> log_queue;
 
+  Mutex channels_lock;  ///< protects channels; taken before any channel_lock
   std::map<std::string, LogChannelRef> channels;
 
 };
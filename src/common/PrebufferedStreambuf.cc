@@ -61,3 +61,10 @@ std::string PrebufferedStreambuf::get_str() const
     return std::string(m_buf, this->pptr() - m_buf);
   }  
 }
+
+void PrebufferedStreambuf::reset()
+{
+  m_overflow.clear();
+  this->setp(m_buf, m_buf + m_buf_len);
+  this->setg(0, 0, 0);
+}
@@ -37,6 +37,9 @@ public:
 
   /// return a string copy (inefficiently)
   std::string get_str() const;
+
+  /// drop the contents so the buffer can be written again
+  void reset();
 };    
 
 #endif
@@ -115,6 +115,7 @@ public:
       "log_file",
       "log_max_new",
       "log_max_recent",
+      "log_binary",
       "log_to_syslog",
       "err_to_syslog",
       "log_to_stderr",
@@ -151,6 +152,10 @@ public:
     if (changed.count("log_max_recent")) {
       log->set_max_recent(conf->log_max_recent);
     }
+
+    if (changed.count("log_binary")) {
+      log->set_log_binary(conf->log_binary);
+    }
   }
 };
 
@@ -255,6 +260,16 @@ void CephContext::do_command(std::string command, cmdmap_t& cmdmap,
     command == "perf schema") {
     _perf_counters_collection->dump_formatted(f, true);
   }
+  else if (command == "perf histogram dump") {
+    std::string logger;
+    std::string counter;
+    cmd_getval(this, cmdmap, "logger", logger);
+    cmd_getval(this, cmdmap, "counter", counter);
+    _perf_counters_collection->dump_formatted(f, false, logger, counter, true);
+  }
+  else if (command == "perf histogram schema") {
+    _perf_counters_collection->dump_formatted(f, true, "", "", true);
+  }
   else if (command == "perf reset") {
     std::string var;
     if (!cmd_getval(this, cmdmap, "var", var)) {
@@ -396,6 +411,8 @@ CephContext::CephContext(uint32_t module_type_)
   _admin_socket->register_command("perfcounters_schema", "perfcounters_schema", _admin_hook, "");
   _admin_socket->register_command("2", "2", _admin_hook, "");
   _admin_socket->register_command("perf schema", "perf schema", _admin_hook, "dump perfcounters schema");
+  _admin_socket->register_command("perf histogram dump", "perf histogram dump name=logger,type=CephString,req=false name=counter,type=CephString,req=false", _admin_hook, "dump perf histogram values");
+  _admin_socket->register_command("perf histogram schema", "perf histogram schema", _admin_hook, "dump perf histogram schema");
   _admin_socket->register_command("perf reset", "perf reset name=var,type=CephString", _admin_hook, "perf reset <name>: perf reset all or one perfcounter name");
   _admin_socket->register_command("config show", "config show", _admin_hook, "dump current config settings");
   _admin_socket->register_command("config set", "config set name=var,type=CephString name=val,type=CephString,n=N",  _admin_hook, "config set <field> <val> [<val> ...]: set a config variable");
@@ -429,6 +446,8 @@ CephContext::~CephContext()
   _admin_socket->unregister_command("perfcounters_schema");
   _admin_socket->unregister_command("perf schema");
   _admin_socket->unregister_command("2");
+  _admin_socket->unregister_command("perf histogram dump");
+  _admin_socket->unregister_command("perf histogram schema");
   _admin_socket->unregister_command("perf reset");
   _admin_socket->unregister_command("config show");
   _admin_socket->unregister_command("config set");
@@ -37,6 +37,7 @@ OPTION(fatal_signal_handlers, OPT_BOOL, true)
 OPTION(log_file, OPT_STR, "/var/log/ceph/$cluster-$name.log") // default changed by common_preinit()
 OPTION(log_max_new, OPT_INT, 1000) // default changed by common_preinit()
 OPTION(log_max_recent, OPT_INT, 10000) // default changed by common_preinit()
+OPTION(log_binary, OPT_BOOL, false)  // write the log file as binary records; read it with ceph-log-decode
 OPTION(log_to_stderr, OPT_BOOL, true) // default changed by common_preinit()
 OPTION(err_to_stderr, OPT_BOOL, true) // default changed by common_preinit()
 OPTION(log_to_syslog, OPT_BOOL, false)
@@ -53,6 +54,8 @@ OPTION(clog_to_monitors, OPT_STR, "default=true")
 OPTION(clog_to_syslog, OPT_STR, "false")
 OPTION(clog_to_syslog_level, OPT_STR, "info") // this level and above
 OPTION(clog_to_syslog_facility, OPT_STR, "default=daemon audit=local0")
+OPTION(clog_rate_limit, OPT_INT, 0)  // max debug/info/warn entries per second a channel sends to the monitors (0 = unlimited)
+OPTION(clog_dedup_interval, OPT_DOUBLE, 0)  // if >0, send an entry repeated within this many seconds once, plus a repeat count
 
 OPTION(mon_cluster_log_to_syslog, OPT_STR, "default=false")
 OPTION(mon_cluster_log_to_syslog_level, OPT_STR, "info")   // this level and above
@@ -128,6 +131,7 @@ OPTION(heartbeat_interval, OPT_INT, 5)
 OPTION(heartbeat_file, OPT_STR, "")
 OPTION(heartbeat_inject_failure, OPT_INT, 0)    // force an unhealthy heartbeat for N seconds
 OPTION(perf, OPT_BOOL, true)       // enable internal perf counters
+OPTION(perf_shards, OPT_INT, 0)    // spread counters over this many per-cpu shards (0 = off)
 
 OPTION(ms_type, OPT_STR, "simple")   // messenger backend
 OPTION(ms_tcp_nodelay, OPT_BOOL, true)
@@ -176,9 +180,13 @@ OPTION(mon_sync_fs_threshold, OPT_INT, 5)   // sync() when writing this many obj
 OPTION(mon_compact_on_start, OPT_BOOL, false)  // compact leveldb on ceph-mon start
 OPTION(mon_compact_on_bootstrap, OPT_BOOL, false)  // trigger leveldb compaction on bootstrap
 OPTION(mon_compact_on_trim, OPT_BOOL, true)       // compact (a prefix) when we trim old states
+OPTION(mon_compact_on_trim_min, OPT_INT, 0)       // only compact once at least this many versions have been trimmed since the last compaction
+OPTION(mon_trim_erase_range, OPT_BOOL, true)      // trim with a single range op per prefix (once the whole quorum supports it)
 OPTION(mon_tick_interval, OPT_INT, 5)
 OPTION(mon_subscribe_interval, OPT_DOUBLE, 300)
 OPTION(mon_delta_reset_interval, OPT_DOUBLE, 10)   // seconds of inactivity before we reset the pg delta to 0
+OPTION(mon_pg_stats_flush_interval, OPT_DOUBLE, 0)  // if >0, batch pg stats into a pgmap commit at most this often; osds are acked once it commits (pg state changes still commit right away)
+OPTION(mon_osd_cache_size, OPT_INT, 10)  // encoded osdmap epochs (full and incremental each) kept in memory for subscribers
 OPTION(mon_osd_laggy_halflife, OPT_INT, 60*60)        // (seconds) how quickly our laggy estimations decay
 OPTION(mon_osd_laggy_weight, OPT_DOUBLE, .3)          // weight for new 'samples's in laggy estimations
 OPTION(mon_osd_adjust_heartbeat_grace, OPT_BOOL, true)    // true if we should scale based on laggy estimations
@@ -231,18 +239,22 @@ OPTION(mon_slurp_bytes, OPT_INT, 256*1024)    // limit size of slurp messages
 OPTION(mon_client_bytes, OPT_U64, 100ul << 20)  // client msg data allowed in memory (in bytes)
 OPTION(mon_daemon_bytes, OPT_U64, 400ul << 20)  // mds, osd message memory cap (in bytes)
 OPTION(mon_max_log_entries_per_event, OPT_INT, 4096)
+OPTION(mon_log_propose_interval, OPT_DOUBLE, 0)  // if >0, batch cluster log entries for at least this long before proposing them
 OPTION(mon_reweight_min_pgs_per_osd, OPT_U64, 10)   // min pgs per osd for reweight-by-pg command
 OPTION(mon_reweight_min_bytes_per_osd, OPT_U64, 100*1024*1024)   // min bytes per osd for reweight-by-utilization command
 OPTION(mon_health_data_update_interval, OPT_FLOAT, 60.0)
 OPTION(mon_health_to_clog, OPT_BOOL, true)
 OPTION(mon_health_to_clog_interval, OPT_INT, 3600)
 OPTION(mon_health_to_clog_tick_interval, OPT_DOUBLE, 60.0)
+OPTION(mon_health_cache_ttl, OPT_DOUBLE, 0)  // if >0, reuse paxos service health results for up to this many seconds while nothing new is committed
 OPTION(mon_data_avail_crit, OPT_INT, 5)
 OPTION(mon_data_avail_warn, OPT_INT, 30)
 OPTION(mon_data_size_warn, OPT_U64, 15*1024*1024*1024) // issue a warning when the monitor's data store goes over 15GB (in bytes)
 OPTION(mon_config_key_max_entry_size, OPT_INT, 4096) // max num bytes per config-key entry
 OPTION(mon_sync_timeout, OPT_DOUBLE, 60.0)
 OPTION(mon_sync_max_payload_size, OPT_U32, 1048576) // max size for a sync chunk payload (say, 1MB)
+OPTION(mon_sync_max_inflight_chunks, OPT_INT, 4) // chunk requests a syncing mon keeps outstanding
+OPTION(mon_sync_resume, OPT_BOOL, true) // after an interrupted full sync, continue from the last applied key instead of starting over
 OPTION(mon_sync_debug, OPT_BOOL, false) // enable sync-specific debug
 OPTION(mon_sync_debug_leader, OPT_INT, -1) // monitor to be used as the sync leader
 OPTION(mon_sync_debug_provider, OPT_INT, -1) // monitor to be used as the sync provider
@@ -250,6 +262,7 @@ OPTION(mon_sync_debug_provider_fallback, OPT_INT, -1) // monitor to be used as f
 OPTION(mon_inject_sync_get_chunk_delay, OPT_DOUBLE, 0)  // inject N second delay on each get_chunk request
 OPTION(mon_osd_min_down_reporters, OPT_INT, 1)   // number of OSDs who need to report a down OSD for it to count
 OPTION(mon_osd_min_down_reports, OPT_INT, 3)     // number of times a down OSD must be reported for it to count
+OPTION(mon_osd_failure_batch_interval, OPT_DOUBLE, 0)  // if >0, hold a proposal marking osds down this long so other failures join the same epoch
 OPTION(mon_osd_force_trim_to, OPT_INT, 0)   // force mon to trim maps to this point, regardless of min_last_epoch_clean (dangerous, use with care)
 OPTION(mon_mds_force_trim_to, OPT_INT, 0)   // force mon to trim mdsmaps to this point (dangerous, use with care)
 OPTION(crushtool, OPT_STR, "crushtool")
@@ -268,6 +281,7 @@ OPTION(paxos_stash_full_interval, OPT_INT, 25)   // how often (in commits) to st
 OPTION(paxos_max_join_drift, OPT_INT, 10) // max paxos iterations before we must first sync the monitor stores
 OPTION(paxos_propose_interval, OPT_DOUBLE, 1.0)  // gather updates for this long before proposing a map update
 OPTION(paxos_min_wait, OPT_DOUBLE, 0.05)  // min time to gather updates for after period of inactivity
+OPTION(paxos_propose_batch_delay, OPT_DOUBLE, 0)  // when a proposal is triggered on an idle leader, wait this long so other services can join the same round
 OPTION(paxos_min, OPT_INT, 500)       // minimum number of paxos states to keep around
 OPTION(paxos_trim_min, OPT_INT, 250)  // number of extra proposals tolerated before trimming
 OPTION(paxos_trim_max, OPT_INT, 500) // max number of extra proposals to trim at a time
@@ -320,6 +334,9 @@ OPTION(client_debug_force_sync_read, OPT_BOOL, false)     // always read synchro
 OPTION(client_debug_inject_tick_delay, OPT_INT, 0) // delay the client tick for a number of seconds
 OPTION(client_max_inline_size, OPT_U64, 4096)
 OPTION(client_inject_release_failure, OPT_BOOL, false)  // synthetic client bug for testing
+OPTION(client_async_unlink, OPT_BOOL, false)  // complete unlinks locally and send them to the MDS in the background; errors show up on fsync/closedir of the directory
+OPTION(client_async_dirop_threads, OPT_INT, 8)  // background directory ops in flight at once
+OPTION(client_async_dirops_max, OPT_INT, 1024)  // queued background directory ops before unlink blocks
 // note: the max amount of "in flight" dirty data is roughly (max - target)
 OPTION(fuse_use_invalidate_cb, OPT_BOOL, false) // use fuse 2.8+ invalidate callback to keep page cache consistent
 OPTION(fuse_allow_other, OPT_BOOL, true)
@@ -346,6 +363,8 @@ OPTION(journaler_prefetch_periods, OPT_INT, 10)   // * journal object size
 OPTION(journaler_prezero_periods, OPT_INT, 5)     // * journal object size
 OPTION(journaler_batch_interval, OPT_DOUBLE, .001)   // seconds.. max add latency we artificially incur
 OPTION(journaler_batch_max, OPT_U64, 0)  // max bytes we'll delay flushing; disable, for now....
+OPTION(journaler_group_commit_inflight, OPT_U64, 0)  // hold flushes while this many writes are in flight; 0 disables group commit
+OPTION(journaler_group_commit_latency, OPT_DOUBLE, .005)  // seconds.. stop holding flushes once the oldest held one has waited this long
 OPTION(mds_data, OPT_STR, "/var/lib/ceph/mds/$cluster-$id")
 OPTION(mds_max_file_size, OPT_U64, 1ULL << 40)
 OPTION(mds_cache_size, OPT_INT, 100000)
@@ -353,6 +372,7 @@ OPTION(mds_cache_mid, OPT_FLOAT, .7)
 OPTION(mds_max_file_recover, OPT_U32, 32)
 OPTION(mds_mem_max, OPT_INT, 1048576)        // KB
 OPTION(mds_dir_max_commit_size, OPT_INT, 10) // MB
+OPTION(mds_dir_fetch_dentry_min, OPT_U64, 10000) // read single dentries from incomplete dirfrags with at least this many entries (0 = always load whole dirfrag)
 OPTION(mds_decay_halflife, OPT_FLOAT, 5)
 OPTION(mds_beacon_interval, OPT_FLOAT, 4)
 OPTION(mds_beacon_grace, OPT_FLOAT, 15)
@@ -372,6 +392,8 @@ OPTION(mds_dirstat_min_interval, OPT_FLOAT, 1)    // try to avoid propagating mo
 OPTION(mds_scatter_nudge_interval, OPT_FLOAT, 5)  // how quickly dirstat changes propagate up the hierarchy
 OPTION(mds_client_prealloc_inos, OPT_INT, 1000)
 OPTION(mds_early_reply, OPT_BOOL, true)
+OPTION(mds_client_fast_dispatch, OPT_BOOL, false) // queue client messages off the messenger threads and drain them in batches
+OPTION(mds_client_dispatch_batch, OPT_U32, 64)  // max client messages handled per mds_lock acquisition
 OPTION(mds_default_dir_hash, OPT_INT, CEPH_STR_HASH_RJENKINS)
 OPTION(mds_log, OPT_BOOL, true)
 OPTION(mds_log_skip_corrupt_events, OPT_BOOL, false)
@@ -381,6 +403,8 @@ OPTION(mds_log_segment_size, OPT_INT, 0)  // segment size for mds log,
 	      // defaults to g_default_file_layout.fl_object_size (4MB)
 OPTION(mds_log_max_segments, OPT_INT, 30)
 OPTION(mds_log_max_expiring, OPT_INT, 20)
+OPTION(mds_log_replay_prefetch_periods, OPT_U64, 0)  // journal read-ahead during replay, in object periods; 0 uses journaler_prefetch_periods
+OPTION(mds_log_replay_queue_max, OPT_U32, 1024)  // decoded events allowed to wait for the replay apply thread
 OPTION(mds_bal_sample_interval, OPT_FLOAT, 3.0)  // every 5 seconds
 OPTION(mds_bal_replicate_threshold, OPT_FLOAT, 8000)
 OPTION(mds_bal_unreplicate_threshold, OPT_FLOAT, 0)
@@ -394,6 +418,10 @@ OPTION(mds_bal_merge_rd, OPT_FLOAT, 1000)
 OPTION(mds_bal_merge_wr, OPT_FLOAT, 1000)
 OPTION(mds_bal_interval, OPT_INT, 10)           // seconds
 OPTION(mds_bal_fragment_interval, OPT_INT, 5)      // seconds
+OPTION(mds_bal_split_horizon, OPT_FLOAT, 30)    // split early if growth will cross mds_bal_split_size within this many seconds
+OPTION(mds_bal_split_contention, OPT_FLOAT, 5)  // split if requests wait on a dirfrag's locks this often (per second)
+OPTION(mds_bal_frag_export, OPT_BOOL, false)    // export hot fragments to other active ranks
+OPTION(mds_bal_frag_history, OPT_INT, 100)      // fragmentation decisions kept for "dirfrag history"
 OPTION(mds_bal_idle_threshold, OPT_FLOAT, 0)
 OPTION(mds_bal_max, OPT_INT, -1)
 OPTION(mds_bal_max_until, OPT_INT, -1)
@@ -438,6 +466,8 @@ OPTION(max_mds, OPT_INT, 1)
 OPTION(mds_standby_for_name, OPT_STR, "")
 OPTION(mds_standby_for_rank, OPT_INT, -1)
 OPTION(mds_standby_replay, OPT_BOOL, false)
+OPTION(mds_standby_replay_tail_interval, OPT_FLOAT, .1) // time between standby-replay passes while the journal is growing
+OPTION(mds_standby_replay_prefetch_dirfrags, OPT_U32, 1000) // recently modified dirfrags to load after taking over from standby-replay
 OPTION(mds_enable_op_tracker, OPT_BOOL, true) // enable/disable MDS op tracking
 OPTION(mds_op_history_size, OPT_U32, 20)    // Max number of completed ops to track
 OPTION(mds_op_history_duration, OPT_U32, 600) // Oldest completed op to track
@@ -812,6 +842,8 @@ OPTION(filestore_queue_committing_max_bytes, OPT_INT, 100 << 20) //  "
 OPTION(filestore_op_threads, OPT_INT, 2)
 OPTION(filestore_op_thread_timeout, OPT_INT, 60)
 OPTION(filestore_op_thread_suicide_timeout, OPT_INT, 180)
+OPTION(filestore_apply_finisher_threads, OPT_INT, 1)   // threads completing onreadable callbacks
+OPTION(filestore_ondisk_finisher_threads, OPT_INT, 1)  // threads completing ondisk callbacks
 OPTION(filestore_commit_timeout, OPT_FLOAT, 600)
 OPTION(filestore_fiemap_threshold, OPT_INT, 4096)
 OPTION(filestore_merge_threshold, OPT_INT, 10)
@@ -61,6 +61,25 @@ inline std::ostream& operator<<(std::ostream& out, _bad_endl_use_dendl_t) {
 #define lgeneric_dout(cct, v) dout_impl(cct, ceph_subsys_, v) *_dout
 #define lgeneric_derr(cct) dout_impl(cct, ceph_subsys_, -1) *_dout
 
+// deferred formatting: arguments are recorded raw and only turned into
+// text when the entry is written out.  no dout_prefix is applied.
+//
+//   ldout_fmt(cct, 10, "read %d bytes from %s") % len % name << dendl;
+#define dout_fmt_impl(cct, sub, v, fmt)					\
+  do {									\
+  if (cct->_conf->subsys.should_gather(sub, v)) {			\
+    if (0) {								\
+      char __array[((v >= -1) && (v <= 200)) ? 0 : -1] __attribute__((unused)); \
+    }									\
+    ceph::log::Entry *_dout_e = cct->_log->create_entry(v, sub);	\
+    CephContext *_dout_cct = cct;					\
+    _dout_e->set_fmt(fmt);						\
+    ceph::log::EntryArgs(_dout_e)
+
+#define lsubdout_fmt(cct, sub, v, fmt)  dout_fmt_impl(cct, ceph_subsys_##sub, v, fmt)
+#define ldout_fmt(cct, v, fmt)  dout_fmt_impl(cct, dout_subsys, v, fmt)
+#define lgeneric_dout_fmt(cct, v, fmt)  dout_fmt_impl(cct, ceph_subsys_, v, fmt)
+
 #define ldlog_p1(cct, sub, lvl)                 \
   (cct->_conf->subsys.should_gather((sub), (lvl)))
 
@@ -21,13 +21,59 @@
 
 #include <errno.h>
 #include <map>
+#include <math.h>
+#include <sched.h>
 #include <sstream>
 #include <stdint.h>
+#include <stdlib.h>
 #include <string.h>
 #include <string>
 
 using std::ostringstream;
 
+#define PERF_SHARD_ALIGN 64
+
+static inline int histogram_bucket(uint64_t v)
+{
+  return v ? 64 - __builtin_clzll(v) : 0;
+}
+
+/// largest value that lands in bucket b
+static inline uint64_t histogram_bucket_max(int b)
+{
+  if (b == 0)
+    return 0;
+  if (b == 64)
+    return (uint64_t)-1;
+  return (1ull << b) - 1;
+}
+
+/// upper bound of the bucket holding the p'th fraction of the values
+static uint64_t histogram_percentile(const std::vector<uint64_t>& counts,
+				     uint64_t total, double p)
+{
+  uint64_t target = (uint64_t)ceil(p * (double)total);
+  if (target == 0)
+    target = 1;
+  uint64_t cum = 0;
+  for (unsigned b = 0; b < counts.size(); ++b) {
+    cum += counts[b];
+    if (cum >= target)
+      return histogram_bucket_max(b);
+  }
+  return histogram_bucket_max(counts.size() - 1);
+}
+
+static void dump_value(Formatter *f, const char *name, int type, uint64_t v)
+{
+  if (type & PERFCOUNTER_TIME)
+    f->dump_format_unquoted(name, "%" PRId64 ".%09" PRId64,
+			    v / 1000000000ull,
+			    v % 1000000000ull);
+  else
+    f->dump_unsigned(name, v);
+}
+
 PerfCountersCollection::PerfCountersCollection(CephContext *cct)
   : m_cct(cct),
     m_lock("PerfCountersCollection")
@@ -111,12 +157,15 @@ bool PerfCountersCollection::reset(const std::string &name)
  * @param counter name of counter within subsystem, e.g. "num_strays",
  *                may be empty.
  * @param schema if true, output schema instead of current data.
+ * @param histograms if true, output only the 2-D histograms, which are
+ *                   otherwise left out.
  */
 void PerfCountersCollection::dump_formatted(
     Formatter *f,
     bool schema,
     const std::string &logger,
-    const std::string &counter)
+    const std::string &counter,
+    bool histograms)
 {
   Mutex::Locker lck(m_lock);
   f->open_object_section("perfcounter_collection");
@@ -125,7 +174,7 @@ void PerfCountersCollection::dump_formatted(
        l != m_loggers.end(); ++l) {
     // Optionally filter on logger name, pass through counter filter
     if (logger.empty() || (*l)->get_name() == logger) {
-      (*l)->dump_formatted(f, schema, counter);
+      (*l)->dump_formatted(f, schema, counter, histograms);
     }
   }
   f->close_section();
@@ -135,6 +184,17 @@ void PerfCountersCollection::dump_formatted(
 
 PerfCounters::~PerfCounters()
 {
+  for (perf_counter_data_vec_t::iterator d = m_data.begin();
+       d != m_data.end(); ++d) {
+    delete[] d->histogram;
+    delete d->histogram_2d;
+  }
+  if (m_shards) {
+    for (int i = 0; i < m_num_shards; ++i)
+      for (int j = 0; j < m_num_sharded; ++j)
+	_shard_at(i, j)->~perf_counter_shard_d();
+    ::free(m_shards);
+  }
 }
 
 void PerfCounters::inc(int idx, uint64_t amt)
@@ -147,13 +207,7 @@ void PerfCounters::inc(int idx, uint64_t amt)
   perf_counter_data_any_d& data(m_data[idx - m_lower_bound - 1]);
   if (!(data.type & PERFCOUNTER_U64))
     return;
-  if (data.type & PERFCOUNTER_LONGRUNAVG) {
-    data.avgcount.inc();
-    data.u64.add(amt);
-    data.avgcount2.inc();
-  } else {
-    data.u64.add(amt);
-  }
+  _add(data, amt);
 }
 
 void PerfCounters::dec(int idx, uint64_t amt)
@@ -180,6 +234,7 @@ void PerfCounters::set(int idx, uint64_t amt)
   perf_counter_data_any_d& data(m_data[idx - m_lower_bound - 1]);
   if (!(data.type & PERFCOUNTER_U64))
     return;
+  _reset_shards(data);
   if (data.type & PERFCOUNTER_LONGRUNAVG) {
     data.avgcount.inc();
     data.u64.set(amt);
@@ -199,7 +254,7 @@ uint64_t PerfCounters::get(int idx) const
   const perf_counter_data_any_d& data(m_data[idx - m_lower_bound - 1]);
   if (!(data.type & PERFCOUNTER_U64))
     return 0;
-  return data.u64.read();
+  return _read_u64(data);
 }
 
 void PerfCounters::tinc(int idx, utime_t amt)
@@ -212,13 +267,7 @@ void PerfCounters::tinc(int idx, utime_t amt)
   perf_counter_data_any_d& data(m_data[idx - m_lower_bound - 1]);
   if (!(data.type & PERFCOUNTER_TIME))
     return;
-  if (data.type & PERFCOUNTER_LONGRUNAVG) {
-    data.avgcount.inc();
-    data.u64.add(amt.to_nsec());
-    data.avgcount2.inc();
-  } else {
-    data.u64.add(amt.to_nsec());
-  }
+  _add(data, amt.to_nsec());
 }
 
 void PerfCounters::tset(int idx, utime_t amt)
@@ -246,7 +295,7 @@ utime_t PerfCounters::tget(int idx) const
   const perf_counter_data_any_d& data(m_data[idx - m_lower_bound - 1]);
   if (!(data.type & PERFCOUNTER_TIME))
     return utime_t();
-  uint64_t v = data.u64.read();
+  uint64_t v = _read_u64(data);
   return utime_t(v / 1000000000ull, v % 1000000000ull);
 }
 
@@ -262,10 +311,39 @@ pair<uint64_t, uint64_t> PerfCounters::get_tavg_ms(int idx) const
     return make_pair(0, 0);
   if (!(data.type & PERFCOUNTER_LONGRUNAVG))
     return make_pair(0, 0);
-  pair<uint64_t,uint64_t> a = data.read_avg();
+  pair<uint64_t,uint64_t> a = _read_avg(data);
   return make_pair(a.second, a.first / 1000000ull);
 }
 
+void PerfCounters::get_histogram(int idx, std::vector<uint64_t> *counts) const
+{
+  counts->clear();
+  if (!m_cct->_conf->perf)
+    return;
+
+  assert(idx > m_lower_bound);
+  assert(idx < m_upper_bound);
+  const perf_counter_data_any_d& data(m_data[idx - m_lower_bound - 1]);
+  if (!data.histogram)
+    return;
+  counts->resize(HISTOGRAM_BUCKETS);
+  for (int i = 0; i < HISTOGRAM_BUCKETS; ++i)
+    (*counts)[i] = data.histogram[i].read();
+}
+
+void PerfCounters::hinc(int idx, int64_t x, int64_t y)
+{
+  if (!m_cct->_conf->perf)
+    return;
+
+  assert(idx > m_lower_bound);
+  assert(idx < m_upper_bound);
+  perf_counter_data_any_d& data(m_data[idx - m_lower_bound - 1]);
+  if (!(data.type & PERFCOUNTER_HISTOGRAM_2D))
+    return;
+  data.histogram_2d->inc(x, y);
+}
+
 void PerfCounters::reset()
 {
   perf_counter_data_vec_t::iterator d = m_data.begin();
@@ -273,12 +351,14 @@ void PerfCounters::reset()
 
   while (d != d_end) {
     d->reset();
+    if (d->type != PERFCOUNTER_U64)
+      _reset_shards(*d);
     ++d;
   }
 }
 
 void PerfCounters::dump_formatted(Formatter *f, bool schema,
-    const std::string &counter)
+    const std::string &counter, bool histograms)
 {
   f->open_object_section(m_name.c_str());
   
@@ -288,6 +368,8 @@ void PerfCounters::dump_formatted(Formatter *f, bool schema,
       // Optionally filter on counter name
       continue;
     }
+    if (histograms != !!(d->type & PERFCOUNTER_HISTOGRAM_2D))
+      continue;
 
     if (schema) {
       f->open_object_section(d->name);
@@ -304,11 +386,17 @@ void PerfCounters::dump_formatted(Formatter *f, bool schema,
       } else {
         f->dump_string("nick", "");
       }
+      if (d->histogram_2d)
+	d->histogram_2d->dump_schema(f);
+      f->close_section();
+    } else if (d->histogram_2d) {
+      f->open_object_section(d->name);
+      d->histogram_2d->dump(f);
       f->close_section();
     } else {
       if (d->type & PERFCOUNTER_LONGRUNAVG) {
 	f->open_object_section(d->name);
-	pair<uint64_t,uint64_t> a = d->read_avg();
+	pair<uint64_t,uint64_t> a = _read_avg(*d);
 	if (d->type & PERFCOUNTER_U64) {
 	  f->dump_unsigned("avgcount", a.second);
 	  f->dump_unsigned("sum", a.first);
@@ -320,9 +408,11 @@ void PerfCounters::dump_formatted(Formatter *f, bool schema,
 	} else {
 	  assert(0);
 	}
+	if (d->histogram)
+	  dump_histogram(f, *d);
 	f->close_section();
       } else {
-	uint64_t v = d->u64.read();
+	uint64_t v = _read_u64(*d);
 	if (d->type & PERFCOUNTER_U64) {
 	  f->dump_unsigned(d->name, v);
 	} else if (d->type & PERFCOUNTER_TIME) {
@@ -338,6 +428,134 @@ void PerfCounters::dump_formatted(Formatter *f, bool schema,
   f->close_section();
 }
 
+void PerfCounters::dump_histogram(Formatter *f,
+				  const perf_counter_data_any_d& data) const
+{
+  std::vector<uint64_t> counts(HISTOGRAM_BUCKETS);
+  uint64_t total = 0;
+  for (int i = 0; i < HISTOGRAM_BUCKETS; ++i) {
+    counts[i] = data.histogram[i].read();
+    total += counts[i];
+  }
+
+  f->open_object_section("histogram");
+  if (total) {
+    dump_value(f, "p50", data.type, histogram_percentile(counts, total, .5));
+    dump_value(f, "p90", data.type, histogram_percentile(counts, total, .9));
+    dump_value(f, "p99", data.type, histogram_percentile(counts, total, .99));
+    dump_value(f, "p999", data.type, histogram_percentile(counts, total, .999));
+  }
+  f->open_array_section("buckets");
+  for (int i = 0; i < HISTOGRAM_BUCKETS; ++i) {
+    if (!counts[i])
+      continue;
+    f->open_object_section("bucket");
+    dump_value(f, "max", data.type, histogram_bucket_max(i));
+    f->dump_unsigned("count", counts[i]);
+    f->close_section();
+  }
+  f->close_section();
+  f->close_section();
+}
+
+void PerfCounters::_setup_shards(int num_shards)
+{
+  if (num_shards <= 0)
+    return;
+  int n = 0;
+  for (perf_counter_data_vec_t::iterator d = m_data.begin();
+       d != m_data.end(); ++d) {
+    if (d->type & (PERFCOUNTER_COUNTER | PERFCOUNTER_LONGRUNAVG))
+      d->shard = n++;
+  }
+  if (!n)
+    return;
+
+  // pad each shard out to whole cache lines so that cpus don't share them
+  m_shard_stride = (sizeof(perf_counter_shard_d) * n + PERF_SHARD_ALIGN - 1) /
+    PERF_SHARD_ALIGN * PERF_SHARD_ALIGN;
+  void *p;
+  int r = ::posix_memalign(&p, PERF_SHARD_ALIGN, m_shard_stride * num_shards);
+  assert(r == 0);
+  m_shards = (char *)p;
+  m_num_shards = num_shards;
+  m_num_sharded = n;
+  for (int i = 0; i < m_num_shards; ++i)
+    for (int j = 0; j < n; ++j)
+      new (_shard_at(i, j)) perf_counter_shard_d;
+}
+
+PerfCounters::perf_counter_shard_d *PerfCounters::_get_shard(
+  const perf_counter_data_any_d& data) const
+{
+  if (!m_shards || data.shard < 0)
+    return NULL;
+#ifdef __linux__
+  int cpu = sched_getcpu();
+  if (cpu < 0)
+    cpu = 0;
+#else
+  int cpu = (int)(((uintptr_t)pthread_self() >> 6) & 0x7fffffff);
+#endif
+  return _shard_at(cpu % m_num_shards, data.shard);
+}
+
+void PerfCounters::_add(perf_counter_data_any_d& data, uint64_t v)
+{
+  perf_counter_shard_d *s = _get_shard(data);
+  if (data.type & PERFCOUNTER_LONGRUNAVG) {
+    if (s) {
+      s->avgcount.inc();
+      s->u64.add(v);
+      s->avgcount2.inc();
+    } else {
+      data.avgcount.inc();
+      data.u64.add(v);
+      data.avgcount2.inc();
+    }
+  } else {
+    if (s)
+      s->u64.add(v);
+    else
+      data.u64.add(v);
+  }
+  if (data.histogram)
+    data.histogram[histogram_bucket(v)].inc();
+}
+
+void PerfCounters::_reset_shards(const perf_counter_data_any_d& data)
+{
+  if (!m_shards || data.shard < 0)
+    return;
+  for (int i = 0; i < m_num_shards; ++i)
+    _shard_at(i, data.shard)->reset();
+}
+
+uint64_t PerfCounters::_read_u64(const perf_counter_data_any_d& data) const
+{
+  uint64_t v = data.u64.read();
+  if (m_shards && data.shard >= 0) {
+    for (int i = 0; i < m_num_shards; ++i)
+      v += _shard_at(i, data.shard)->u64.read();
+  }
+  return v;
+}
+
+pair<uint64_t,uint64_t> PerfCounters::_read_avg(
+  const perf_counter_data_any_d& data) const
+{
+  pair<uint64_t,uint64_t> a = data.read_avg();
+  if (m_shards && data.shard >= 0) {
+    for (int i = 0; i < m_num_shards; ++i) {
+      pair<uint64_t,uint64_t> s =
+	_shard_at(i, data.shard)->read_avg();
+      a.first += s.first;
+      a.second += s.second;
+    }
+  }
+  return a;
+}
+
 const std::string &PerfCounters::get_name() const
 {
   return m_name;
@@ -350,7 +568,11 @@ PerfCounters::PerfCounters(CephContext *cct, const std::string &name,
     m_upper_bound(upper_bound),
     m_name(name.c_str()),
     m_lock_name(std::string("PerfCounters::") + name.c_str()),
-    m_lock(m_lock_name.c_str())
+    m_lock(m_lock_name.c_str()),
+    m_shards(NULL),
+    m_num_shards(0),
+    m_num_sharded(0),
+    m_shard_stride(0)
 {
   m_data.resize(upper_bound - lower_bound - 1);
 }
@@ -398,6 +620,31 @@ void PerfCountersBuilder::add_time_avg(int idx, const char *name,
   add_impl(idx, name, description, nick, PERFCOUNTER_TIME | PERFCOUNTER_LONGRUNAVG);
 }
 
+void PerfCountersBuilder::add_u64_hist(int idx, const char *name,
+    const char *description, const char *nick)
+{
+  add_impl(idx, name, description, nick,
+	   PERFCOUNTER_U64 | PERFCOUNTER_LONGRUNAVG | PERFCOUNTER_HISTOGRAM);
+}
+
+void PerfCountersBuilder::add_time_hist(int idx, const char *name,
+    const char *description, const char *nick)
+{
+  add_impl(idx, name, description, nick,
+	   PERFCOUNTER_TIME | PERFCOUNTER_LONGRUNAVG | PERFCOUNTER_HISTOGRAM);
+}
+
+void PerfCountersBuilder::add_histogram_2d(int idx, const char *name,
+    const perf_histogram_axis_d &x, const perf_histogram_axis_d &y,
+    const char *description, const char *nick)
+{
+  add_impl(idx, name, description, nick,
+	   PERFCOUNTER_U64 | PERFCOUNTER_HISTOGRAM_2D);
+  PerfCounters::perf_counter_data_any_d
+    &data(m_perf_counters->m_data[idx - m_perf_counters->m_lower_bound - 1]);
+  data.histogram_2d = new PerfHistogram2D(x, y);
+}
+
 void PerfCountersBuilder::add_impl(int idx, const char *name,
     const char *description, const char *nick, int ty)
 {
@@ -411,6 +658,8 @@ void PerfCountersBuilder::add_impl(int idx, const char *name,
   data.description = description;
   data.nick = nick;
   data.type = (enum perfcounter_type_d)ty;
+  if (ty & PERFCOUNTER_HISTOGRAM)
+    data.histogram = new atomic64_t[PerfCounters::HISTOGRAM_BUCKETS];
 }
 
 PerfCounters *PerfCountersBuilder::create_perf_counters()
@@ -422,6 +671,8 @@ PerfCounters *PerfCountersBuilder::create_perf_counters()
       assert(d->type != PERFCOUNTER_NONE);
     }
   }
+  m_perf_counters->_setup_shards(
+    m_perf_counters->m_cct->_conf->perf_shards);
   PerfCounters *ret = m_perf_counters;
   m_perf_counters = NULL;
   return ret;
@@ -18,6 +18,7 @@
 
 #include "common/config_obs.h"
 #include "common/Mutex.h"
+#include "common/perf_histogram.h"
 #include "include/buffer.h"
 #include "include/utime.h"
 
@@ -36,6 +37,8 @@ enum perfcounter_type_d
   PERFCOUNTER_U64 = 0x2,
   PERFCOUNTER_LONGRUNAVG = 0x4,
   PERFCOUNTER_COUNTER = 0x8,
+  PERFCOUNTER_HISTOGRAM = 0x10,
+  PERFCOUNTER_HISTOGRAM_2D = 0x20,
 };
 
 /*
@@ -61,6 +64,17 @@ enum perfcounter_type_d
  * For the time average, it returns the current value and
  * the "avgcount" member when read off. avgcount is incremented when you call
  * tinc. Calling tset on an average is an error and will assert out.
+ *
+ * An average may also keep a histogram of the individual values, in
+ * power-of-two buckets.  It is dumped along with a few percentiles.
+ *
+ * A 2-D histogram counts (x, y) samples, such as latency against size,
+ * with hinc.  It can be large, so it is left out of the regular dump
+ * and only shows up in the histogram dump.
+ *
+ * If perf_shards is set, counters and averages are spread over that many
+ * cache-line aligned shards, picked by the cpu we are running on, and
+ * summed when they are read.  Gauges are never sharded.
  */
 class PerfCounters
 {
@@ -83,6 +97,9 @@ public:
     }
   };
 
+  /// bucket 0 holds 0, bucket b > 0 holds [2^(b-1), 2^b)
+  static const int HISTOGRAM_BUCKETS = 65;
+
   ~PerfCounters();
 
   void inc(int idx, uint64_t v = 1);
@@ -94,10 +111,13 @@ public:
   void tinc(int idx, utime_t v);
   utime_t tget(int idx) const;
 
+  void hinc(int idx, int64_t x, int64_t y);
+
   void reset();
   void dump_formatted(ceph::Formatter *f, bool schema,
-      const std::string &counter = "");
+      const std::string &counter = "", bool histograms = false);
   pair<uint64_t, uint64_t> get_tavg_ms(int idx) const;
+  void get_histogram(int idx, std::vector<uint64_t> *counts) const;
 
   const std::string& get_name() const;
   void set_name(std::string s) {
@@ -117,6 +137,9 @@ private:
         description(NULL),
         nick(NULL),
 	type(PERFCOUNTER_NONE),
+	shard(-1),
+	histogram(NULL),
+	histogram_2d(NULL),
 	u64(0),
 	avgcount(0),
 	avgcount2(0)
@@ -126,6 +149,9 @@ private:
         description(other.description),
         nick(other.nick),
 	type(other.type),
+	shard(other.shard),
+	histogram(other.histogram),
+	histogram_2d(other.histogram_2d),
 	u64(other.u64.read()) {
       pair<uint64_t,uint64_t> a = other.read_avg();
       u64.set(a.first);
@@ -137,6 +163,9 @@ private:
     const char *description;
     const char *nick;
     enum perfcounter_type_d type;
+    int shard;              ///< offset in each shard, or -1
+    atomic64_t *histogram;  ///< HISTOGRAM_BUCKETS counts, owned by PerfCounters
+    PerfHistogram2D *histogram_2d;  ///< owned by PerfCounters
     atomic64_t u64;
     atomic64_t avgcount;
     atomic64_t avgcount2;
@@ -148,6 +177,12 @@ private:
 	avgcount.set(0);
 	avgcount2.set(0);
       }
+      if (histogram) {
+	for (int i = 0; i < HISTOGRAM_BUCKETS; ++i)
+	  histogram[i].set(0);
+      }
+      if (histogram_2d)
+	histogram_2d->reset();
     }
 
     perf_counter_data_any_d& operator=(const perf_counter_data_any_d& other) {
@@ -155,6 +190,9 @@ private:
       description = other.description;
       nick = other.nick;
       type = other.type;
+      shard = other.shard;
+      histogram = other.histogram;
+      histogram_2d = other.histogram_2d;
       pair<uint64_t,uint64_t> a = other.read_avg();
       u64.set(a.first);
       avgcount.set(a.second);
@@ -174,6 +212,40 @@ private:
   };
   typedef std::vector<perf_counter_data_any_d> perf_counter_data_vec_t;
 
+  /** The per-shard part of a sharded counter or average. */
+  struct perf_counter_shard_d {
+    atomic64_t u64;
+    atomic64_t avgcount;
+    atomic64_t avgcount2;
+
+    perf_counter_shard_d() : u64(0), avgcount(0), avgcount2(0) {}
+
+    void reset() {
+      u64.set(0);
+      avgcount.set(0);
+      avgcount2.set(0);
+    }
+
+    /// read <sum, count> safely
+    pair<uint64_t,uint64_t> read_avg() const {
+      uint64_t sum, count;
+      do {
+	count = avgcount.read();
+	sum = u64.read();
+      } while (avgcount2.read() != count);
+      return make_pair(sum, count);
+    }
+  };
+
+  void dump_histogram(ceph::Formatter *f,
+		      const perf_counter_data_any_d& data) const;
+  void _setup_shards(int num_shards);
+  perf_counter_shard_d *_get_shard(const perf_counter_data_any_d& data) const;
+  void _add(perf_counter_data_any_d& data, uint64_t v);
+  void _reset_shards(const perf_counter_data_any_d& data);
+  uint64_t _read_u64(const perf_counter_data_any_d& data) const;
+  pair<uint64_t,uint64_t> _read_avg(const perf_counter_data_any_d& data) const;
+
   CephContext *m_cct;
   int m_lower_bound;
   int m_upper_bound;
@@ -185,6 +257,17 @@ private:
 
   perf_counter_data_vec_t m_data;
 
+  /// m_num_shards blocks of m_shard_stride bytes, or NULL
+  char *m_shards;
+  int m_num_shards;
+  int m_num_sharded;    ///< entries used in each shard
+  size_t m_shard_stride;
+
+  perf_counter_shard_d *_shard_at(int shard, int offset) const {
+    return (perf_counter_shard_d *)(m_shards + shard * m_shard_stride) +
+      offset;
+  }
+
   friend class PerfCountersBuilder;
 };
 
@@ -213,7 +296,8 @@ public:
       ceph::Formatter *f,
       bool schema,
       const std::string &logger = "",
-      const std::string &counter = "");
+      const std::string &counter = "",
+      bool histograms = false);
 private:
   CephContext *m_cct;
 
@@ -249,6 +333,14 @@ public:
       const char *description=NULL, const char *nick = NULL);
   void add_time_avg(int key, const char *name,
       const char *description=NULL, const char *nick = NULL);
+  /// an average that also keeps a histogram of the values
+  void add_u64_hist(int key, const char *name,
+      const char *description=NULL, const char *nick = NULL);
+  void add_time_hist(int key, const char *name,
+      const char *description=NULL, const char *nick = NULL);
+  void add_histogram_2d(int key, const char *name,
+      const perf_histogram_axis_d &x, const perf_histogram_axis_d &y,
+      const char *description=NULL, const char *nick = NULL);
   PerfCounters* create_perf_counters();
 private:
   PerfCountersBuilder(const PerfCountersBuilder &rhs);
@@ -0,0 +1,112 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#include "common/perf_histogram.h"
+#include "common/Formatter.h"
+#include "include/assert.h"
+
+#include <limits.h>
+
+void perf_histogram_axis_d::get_range(int b, int64_t *lo, int64_t *hi) const
+{
+  assert(b >= 0 && b < buckets);
+  if (b == 0) {
+    *lo = LLONG_MIN;
+    *hi = min - 1;
+    return;
+  }
+  if (scale == SCALE_LINEAR) {
+    *lo = min + quant_size * (b - 1);
+    *hi = min + quant_size * b - 1;
+  } else {
+    *lo = b == 1 ? min : min + (quant_size << (b - 2));
+    *hi = min + (quant_size << (b - 1)) - 1;
+  }
+  if (b == buckets - 1)
+    *hi = LLONG_MAX;
+}
+
+void perf_histogram_axis_d::dump(ceph::Formatter *f) const
+{
+  f->dump_string("name", name);
+  f->dump_string("scale", scale == SCALE_LINEAR ? "linear" : "log2");
+  f->dump_int("min", min);
+  f->dump_int("quant_size", quant_size);
+  f->dump_int("buckets", buckets);
+  f->open_array_section("ranges");
+  for (int b = 0; b < buckets; ++b) {
+    int64_t lo, hi;
+    get_range(b, &lo, &hi);
+    f->open_object_section("range");
+    if (b > 0)
+      f->dump_int("min", lo);
+    if (b < buckets - 1)
+      f->dump_int("max", hi);
+    f->close_section();
+  }
+  f->close_section();
+}
+
+/// the bounds of the last bucket before the overflow have to fit in an int64_t
+static bool axis_fits(const perf_histogram_axis_d& a)
+{
+  int n = a.buckets - 2;
+  int64_t room = a.min >= 0 ? LLONG_MAX - a.min : LLONG_MAX;
+  if (a.scale == perf_histogram_axis_d::SCALE_LINEAR)
+    return a.quant_size <= room / (n ? n : 1);
+  return n < 63 && a.quant_size <= room >> n;
+}
+
+PerfHistogram2D::PerfHistogram2D(const perf_histogram_axis_d& x,
+				 const perf_histogram_axis_d& y)
+  : m_x(x), m_y(y)
+{
+  assert(m_x.buckets >= 2 && m_y.buckets >= 2);
+  assert(m_x.quant_size > 0 && m_y.quant_size > 0);
+  assert(axis_fits(m_x) && axis_fits(m_y));
+  m_counts = new ceph::atomic64_t[m_x.buckets * m_y.buckets];
+}
+
+PerfHistogram2D::~PerfHistogram2D()
+{
+  delete[] m_counts;
+}
+
+void PerfHistogram2D::reset()
+{
+  for (int i = 0; i < m_x.buckets * m_y.buckets; ++i)
+    m_counts[i].set(0);
+}
+
+void PerfHistogram2D::dump_schema(ceph::Formatter *f) const
+{
+  f->open_array_section("axes");
+  f->open_object_section("axis");
+  m_x.dump(f);
+  f->close_section();
+  f->open_object_section("axis");
+  m_y.dump(f);
+  f->close_section();
+  f->close_section();
+}
+
+void PerfHistogram2D::dump(ceph::Formatter *f) const
+{
+  f->open_array_section("values");
+  for (int x = 0; x < m_x.buckets; ++x) {
+    f->open_array_section("x");
+    for (int y = 0; y < m_y.buckets; ++y)
+      f->dump_unsigned("y", read(x, y));
+    f->close_section();
+  }
+  f->close_section();
+}
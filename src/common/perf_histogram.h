@@ -0,0 +1,100 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#ifndef CEPH_COMMON_PERF_HISTOGRAM_H
+#define CEPH_COMMON_PERF_HISTOGRAM_H
+
+#include "include/atomic.h"
+
+#include <stdint.h>
+#include <vector>
+
+namespace ceph {
+  class Formatter;
+}
+
+/**
+ * One axis of a PerfHistogram2D.
+ *
+ * Bucket 0 counts values below min, and the last bucket counts values
+ * past the end of the range.  The buckets in between are quant_size
+ * wide (SCALE_LINEAR), or start quant_size wide and double in width
+ * with each bucket (SCALE_LOG2).
+ */
+struct perf_histogram_axis_d {
+  enum scale_t {
+    SCALE_LINEAR = 0,
+    SCALE_LOG2 = 1,
+  };
+
+  const char *name;
+  scale_t scale;
+  int64_t min;
+  int64_t quant_size;
+  int buckets;     ///< including the underflow and overflow buckets
+
+  int get_bucket(int64_t v) const {
+    if (v < min)
+      return 0;
+    uint64_t r = (uint64_t)(v - min) / (uint64_t)quant_size;
+    uint64_t b;
+    if (scale == SCALE_LINEAR)
+      b = 1 + r;
+    else
+      b = 1 + (r ? 64 - __builtin_clzll(r) : 0);
+    if (b > (uint64_t)buckets - 1)
+      b = buckets - 1;
+    return b;
+  }
+
+  /// the smallest and largest values that land in bucket b
+  void get_range(int b, int64_t *lo, int64_t *hi) const;
+
+  void dump(ceph::Formatter *f) const;
+};
+
+/**
+ * A two-dimensional histogram of (x, y) samples, e.g. op latency
+ * against op size.  Updates are a single atomic increment.
+ */
+class PerfHistogram2D {
+public:
+  PerfHistogram2D(const perf_histogram_axis_d& x,
+		  const perf_histogram_axis_d& y);
+  ~PerfHistogram2D();
+
+  void inc(int64_t x, int64_t y) {
+    int b = m_x.get_bucket(x) * m_y.buckets + m_y.get_bucket(y);
+    m_counts[b].inc();
+  }
+
+  uint64_t read(int x, int y) const {
+    return m_counts[x * m_y.buckets + y].read();
+  }
+
+  void reset();
+
+  /// dump the axes and the ranges of their buckets
+  void dump_schema(ceph::Formatter *f) const;
+  /// dump the counts, one array of y values for each x bucket
+  void dump(ceph::Formatter *f) const;
+
+private:
+  PerfHistogram2D(const PerfHistogram2D &rhs);
+  PerfHistogram2D& operator=(const PerfHistogram2D &rhs);
+
+  perf_histogram_axis_d m_x;
+  perf_histogram_axis_d m_y;
+  ceph::atomic64_t *m_counts;
+};
+
+#endif
@@ -68,13 +68,23 @@ namespace librbd {
     utime_t elapsed;
     assert(lock.is_locked());
     elapsed = ceph_clock_now(ictx->cct) - start_time;
+    int64_t elapsed_usec = elapsed.to_nsec() / 1000;
     switch (aio_type) {
     case AIO_TYPE_READ:
-      ictx->perfcounter->tinc(l_librbd_aio_rd_latency, elapsed); break;
+      ictx->perfcounter->tinc(l_librbd_aio_rd_latency, elapsed);
+      ictx->perfcounter->hinc(l_librbd_aio_rd_lat_size_hist, elapsed_usec,
+			      io_len);
+      break;
     case AIO_TYPE_WRITE:
-      ictx->perfcounter->tinc(l_librbd_aio_wr_latency, elapsed); break;
+      ictx->perfcounter->tinc(l_librbd_aio_wr_latency, elapsed);
+      ictx->perfcounter->hinc(l_librbd_aio_wr_lat_size_hist, elapsed_usec,
+			      io_len);
+      break;
     case AIO_TYPE_DISCARD:
-      ictx->perfcounter->tinc(l_librbd_aio_discard_latency, elapsed); break;
+      ictx->perfcounter->tinc(l_librbd_aio_discard_latency, elapsed);
+      ictx->perfcounter->hinc(l_librbd_aio_discard_lat_size_hist,
+			      elapsed_usec, io_len);
+      break;
     case AIO_TYPE_FLUSH:
       ictx->perfcounter->tinc(l_librbd_aio_flush_latency, elapsed); break;
     default:
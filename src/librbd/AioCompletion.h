@@ -56,6 +56,7 @@ namespace librbd {
     ImageCtx *ictx;
     utime_t start_time;
     aio_type_t aio_type;
+    uint64_t io_len;     ///< bytes covered by the request
 
     Striper::StripedReadResult destriper;
     bufferlist *read_bl;
@@ -69,7 +70,7 @@ namespace librbd {
 		      complete_arg(NULL), rbd_comp(NULL),
 		      pending_count(0), blockers(1),
 		      ref(1), released(false), ictx(NULL),
-		      aio_type(AIO_TYPE_NONE),
+		      aio_type(AIO_TYPE_NONE), io_len(0),
 		      read_bl(NULL), read_buf(NULL), read_buf_len(0) {
     }
     ~AioCompletion() {
@@ -258,6 +258,19 @@ namespace librbd {
     plb.add_time_avg(l_librbd_aio_discard_latency, "aio_discard_latency");
     plb.add_u64_counter(l_librbd_aio_flush, "aio_flush");
     plb.add_time_avg(l_librbd_aio_flush_latency, "aio_flush_latency");
+    perf_histogram_axis_d lat_axis = {
+      "latency_usec", perf_histogram_axis_d::SCALE_LOG2, 0, 100, 20
+    };
+    perf_histogram_axis_d size_axis = {
+      "size_bytes", perf_histogram_axis_d::SCALE_LOG2, 0, 512, 16
+    };
+    plb.add_histogram_2d(l_librbd_aio_rd_lat_size_hist,
+			 "aio_rd_latency_size_histogram", lat_axis, size_axis);
+    plb.add_histogram_2d(l_librbd_aio_wr_lat_size_hist,
+			 "aio_wr_latency_size_histogram", lat_axis, size_axis);
+    plb.add_histogram_2d(l_librbd_aio_discard_lat_size_hist,
+			 "aio_discard_latency_size_histogram", lat_axis,
+			 size_axis);
     plb.add_u64_counter(l_librbd_snap_create, "snap_create");
     plb.add_u64_counter(l_librbd_snap_remove, "snap_remove");
     plb.add_u64_counter(l_librbd_snap_rollback, "snap_rollback");
@@ -3353,6 +3353,7 @@ reprotect_and_return_err:
 
       c->get();
       c->init_time(ictx, AIO_TYPE_WRITE);
+      c->io_len = clip_len;
     }
 
     if (ictx->image_watcher->is_lock_supported() &&
@@ -3508,6 +3509,7 @@ reprotect_and_return_err:
 
       c->get();
       c->init_time(ictx, AIO_TYPE_DISCARD);
+      c->io_len = clip_len;
     }
 
     if (ictx->image_watcher->is_lock_supported() &&
@@ -3697,6 +3699,7 @@ reprotect_and_return_err:
 
       c->get();
       c->init_time(ictx, AIO_TYPE_READ);
+      c->io_len = buffer_ofs;
     }
 
     int64_t ret;
@@ -39,6 +39,9 @@ enum {
   l_librbd_aio_discard_latency,
   l_librbd_aio_flush,
   l_librbd_aio_flush_latency,
+  l_librbd_aio_rd_lat_size_hist,
+  l_librbd_aio_wr_lat_size_hist,
+  l_librbd_aio_discard_lat_size_hist,
 
   l_librbd_snap_create,
   l_librbd_snap_remove,
@@ -0,0 +1,249 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+
+#include "Entry.h"
+
+#include <stdio.h>
+
+namespace ceph {
+namespace log {
+
+/*
+ * packed argument layout in m_static_buf:
+ *
+ *   'i' int64, 'u' uint64, 'p' pointer (as uint64), 'f' double:
+ *       type byte + 8 bytes
+ *   's' string:
+ *       type byte + length byte + up to 255 bytes
+ *
+ * binary log record (host byte order):
+ *
+ *   u16 marker, u8 kind, u8 pad, u32 length of the rest,
+ *   u32 sec, u32 nsec, u64 thread, s16 prio, s16 subsys, then
+ *   kind 0: text
+ *   kind 1: u16 fmt length, fmt, u8 truncated, packed arguments
+ */
+
+#define BINARY_MARKER 0xce10
+#define BINARY_HEADER_LEN 28
+
+void Entry::add_arg(char type, const void *v, unsigned len)
+{
+  unsigned room = sizeof(m_static_buf) - m_args_len;
+  if (type == 's') {
+    if (room < 2) {
+      m_args_trunc = true;
+      return;
+    }
+    if (len > 255)
+      len = 255;
+    if (len > room - 2) {
+      len = room - 2;
+      m_args_trunc = true;
+    }
+    m_static_buf[m_args_len] = type;
+    m_static_buf[m_args_len + 1] = (unsigned char)len;
+    memcpy(m_static_buf + m_args_len + 2, v, len);
+    m_args_len += 2 + len;
+  } else {
+    if (room < 1 + len) {
+      m_args_trunc = true;
+      return;
+    }
+    m_static_buf[m_args_len] = type;
+    memcpy(m_static_buf + m_args_len + 1, v, len);
+    m_args_len += 1 + len;
+  }
+}
+
+void Entry::format_args(const char *fmt, const char *args, unsigned len,
+			bool trunc, std::string *out)
+{
+  unsigned pos = 0;
+  char buf[64];
+  const char *p = fmt;
+  while (*p) {
+    if (*p != '%') {
+      const char *q = strchr(p, '%');
+      if (!q)
+	q = p + strlen(p);
+      out->append(p, q - p);
+      p = q;
+      continue;
+    }
+    ++p;
+    if (*p == '%') {
+      out->append(1, '%');
+      ++p;
+      continue;
+    }
+    // skip flags, width, precision and length modifiers
+    while (*p && strchr("-+ #0123456789.hlLqjzt", *p))
+      ++p;
+    char conv = *p;
+    if (*p)
+      ++p;
+
+    if (pos >= len) {
+      out->append("<?>");
+      continue;
+    }
+    char type = args[pos];
+    if (type == 's') {
+      unsigned slen = pos + 2 <= len ? (unsigned char)args[pos + 1] : len;
+      if (pos + 2 + slen > len) {
+	out->append("<?>");
+	pos = len;
+	continue;
+      }
+      out->append(args + pos + 2, slen);
+      pos += 2 + slen;
+      continue;
+    }
+    if (pos + 9 > len) {
+      out->append("<?>");
+      pos = len;
+      continue;
+    }
+    char v[8];
+    memcpy(v, args + pos + 1, 8);
+    pos += 9;
+    switch (type) {
+    case 'i':
+      {
+	int64_t i;
+	memcpy(&i, v, 8);
+	if (conv == 'x')
+	  snprintf(buf, sizeof(buf), "%llx", (unsigned long long)i);
+	else if (conv == 'o')
+	  snprintf(buf, sizeof(buf), "%llo", (unsigned long long)i);
+	else
+	  snprintf(buf, sizeof(buf), "%lld", (long long)i);
+      }
+      break;
+    case 'u':
+      {
+	uint64_t u;
+	memcpy(&u, v, 8);
+	if (conv == 'x')
+	  snprintf(buf, sizeof(buf), "%llx", (unsigned long long)u);
+	else if (conv == 'o')
+	  snprintf(buf, sizeof(buf), "%llo", (unsigned long long)u);
+	else
+	  snprintf(buf, sizeof(buf), "%llu", (unsigned long long)u);
+      }
+      break;
+    case 'p':
+      {
+	uint64_t u;
+	memcpy(&u, v, 8);
+	snprintf(buf, sizeof(buf), "0x%llx", (unsigned long long)u);
+      }
+      break;
+    case 'f':
+      {
+	double d;
+	memcpy(&d, v, 8);
+	snprintf(buf, sizeof(buf), "%g", d);
+      }
+      break;
+    default:
+      snprintf(buf, sizeof(buf), "<bad arg type %d>", (int)type);
+      pos = len;
+    }
+    out->append(buf);
+  }
+  if (trunc)
+    out->append(" [truncated]");
+}
+
+void Entry::encode_binary(std::string *out) const
+{
+  char h[BINARY_HEADER_LEN];
+  uint16_t marker = BINARY_MARKER;
+  uint8_t kind = m_fmt ? 1 : 0;
+  uint8_t pad = 0;
+  uint32_t sec = m_stamp.sec(), nsec = m_stamp.nsec();
+  uint64_t thread = (uint64_t)m_thread;
+  int16_t prio = m_prio, subsys = m_subsys;
+
+  std::string body;
+  if (m_fmt) {
+    uint16_t fmt_len = strlen(m_fmt);
+    uint8_t trunc = m_args_trunc;
+    body.append((const char *)&fmt_len, 2);
+    body.append(m_fmt, fmt_len);
+    body.append((const char *)&trunc, 1);
+    body.append(m_static_buf, m_args_len);
+  } else {
+    body = m_streambuf.get_str();
+  }
+  uint32_t rest = BINARY_HEADER_LEN - 8 + body.length();
+
+  memcpy(h, &marker, 2);
+  memcpy(h + 2, &kind, 1);
+  memcpy(h + 3, &pad, 1);
+  memcpy(h + 4, &rest, 4);
+  memcpy(h + 8, &sec, 4);
+  memcpy(h + 12, &nsec, 4);
+  memcpy(h + 16, &thread, 8);
+  memcpy(h + 24, &prio, 2);
+  memcpy(h + 26, &subsys, 2);
+  out->append(h, sizeof(h));
+  out->append(body);
+}
+
+int Entry::decode_binary(const char *p, size_t len,
+			 utime_t *stamp, uint64_t *thread,
+			 short *prio, short *subsys, std::string *text)
+{
+  if (len < 2)
+    return 0;
+  uint16_t marker;
+  memcpy(&marker, p, 2);
+  if (marker != BINARY_MARKER)
+    return -1;
+  if (len < BINARY_HEADER_LEN)
+    return 0;
+
+  uint8_t kind = p[2];
+  uint32_t rest, sec, nsec;
+  int16_t pr, sub;
+  memcpy(&rest, p + 4, 4);
+  if (rest < BINARY_HEADER_LEN - 8)
+    return -1;
+  if (len < 8 + rest)
+    return 0;
+  memcpy(&sec, p + 8, 4);
+  memcpy(&nsec, p + 12, 4);
+  memcpy(thread, p + 16, 8);
+  memcpy(&pr, p + 24, 2);
+  memcpy(&sub, p + 26, 2);
+  *stamp = utime_t(sec, nsec);
+  *prio = pr;
+  *subsys = sub;
+
+  const char *body = p + BINARY_HEADER_LEN;
+  unsigned body_len = rest - (BINARY_HEADER_LEN - 8);
+  text->clear();
+  if (kind == 0) {
+    text->assign(body, body_len);
+  } else if (kind == 1) {
+    uint16_t fmt_len;
+    if (body_len < 3)
+      return -1;
+    memcpy(&fmt_len, body, 2);
+    if (body_len < 3u + fmt_len)
+      return -1;
+    std::string fmt(body + 2, fmt_len);
+    bool trunc = body[2 + fmt_len];
+    format_args(fmt.c_str(), body + 3 + fmt_len, body_len - 3 - fmt_len,
+		trunc, text);
+  } else {
+    return -1;
+  }
+  return 8 + rest;
+}
+
+}
+}
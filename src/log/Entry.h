@@ -7,6 +7,8 @@
 #include "include/utime.h"
 #include "common/PrebufferedStreambuf.h"
 #include <pthread.h>
+#include <stdint.h>
+#include <string.h>
 #include <string>
 
 #define CEPH_LOG_ENTRY_PREALLOC 80
@@ -23,16 +25,27 @@ struct Entry {
   char m_static_buf[CEPH_LOG_ENTRY_PREALLOC];
   PrebufferedStreambuf m_streambuf;
 
+  /*
+   * deferred formatting: if m_fmt is set, m_static_buf holds the raw
+   * arguments (see EntryArgs) and the text is only produced when the
+   * entry is written out.
+   */
+  const char *m_fmt;
+  unsigned short m_args_len;
+  bool m_args_trunc;
+
   Entry()
     : m_thread(0), m_prio(0), m_subsys(0),
       m_next(NULL),
-      m_streambuf(m_static_buf, sizeof(m_static_buf))
+      m_streambuf(m_static_buf, sizeof(m_static_buf)),
+      m_fmt(NULL), m_args_len(0), m_args_trunc(false)
   {}
   Entry(utime_t s, pthread_t t, short pr, short sub,
 	const char *msg = NULL)
     : m_stamp(s), m_thread(t), m_prio(pr), m_subsys(sub),
       m_next(NULL),
-      m_streambuf(m_static_buf, sizeof(m_static_buf))
+      m_streambuf(m_static_buf, sizeof(m_static_buf)),
+      m_fmt(NULL), m_args_len(0), m_args_trunc(false)
   {
     if (msg) {
       ostream os(&m_streambuf);
@@ -46,8 +59,107 @@ struct Entry {
   }
 
   std::string get_str() const {
+    if (m_fmt) {
+      std::string s;
+      format_args(m_fmt, m_static_buf, m_args_len, m_args_trunc, &s);
+      return s;
+    }
     return m_streambuf.get_str();
   }
+
+  /// reinitialize a recycled entry
+  void reset(utime_t s, pthread_t t, short pr, short sub) {
+    m_stamp = s;
+    m_thread = t;
+    m_prio = pr;
+    m_subsys = sub;
+    m_next = NULL;
+    m_streambuf.reset();
+    m_fmt = NULL;
+    m_args_len = 0;
+    m_args_trunc = false;
+  }
+
+  /// switch to deferred formatting with the given (static) format string
+  void set_fmt(const char *fmt) {
+    m_fmt = fmt;
+    m_args_len = 0;
+    m_args_trunc = false;
+  }
+
+  /// append a raw argument; see format_args for the types
+  void add_arg(char type, const void *v, unsigned len);
+
+  /**
+   * produce text from a format string and packed arguments
+   *
+   * Conversions are printf-like, but the type of each argument is
+   * taken from the packed data: %x and %o print integers in hex and
+   * octal, every other conversion prints the argument naturally.
+   * Flags, width and length modifiers are skipped.
+   */
+  static void format_args(const char *fmt, const char *args, unsigned len,
+			  bool trunc, std::string *out);
+
+  /// append this entry as a binary log record
+  void encode_binary(std::string *out) const;
+
+  /**
+   * decode one binary log record
+   *
+   * @returns bytes consumed, 0 if more data is needed, or -1 if @p p
+   *          does not start a record
+   */
+  static int decode_binary(const char *p, size_t len,
+			   utime_t *stamp, uint64_t *thread,
+			   short *prio, short *subsys, std::string *text);
+};
+
+/**
+ * argument collector for deferred-format log entries
+ *
+ *   ldout_fmt(cct, 10, "read %d bytes from %s") % len % name << dendl;
+ *
+ * Arguments are copied into the entry as raw values; strings are
+ * copied and truncated to fit the entry.
+ */
+class EntryArgs {
+  Entry *m_entry;
+
+  template <typename T>
+  EntryArgs& add(char type, T v) {
+    m_entry->add_arg(type, &v, sizeof(v));
+    return *this;
+  }
+
+public:
+  explicit EntryArgs(Entry *e) : m_entry(e) {}
+
+  EntryArgs& operator%(bool v) { return add('i', (int64_t)v); }
+  EntryArgs& operator%(char v) { return add('i', (int64_t)v); }
+  EntryArgs& operator%(short v) { return add('i', (int64_t)v); }
+  EntryArgs& operator%(unsigned short v) { return add('u', (uint64_t)v); }
+  EntryArgs& operator%(int v) { return add('i', (int64_t)v); }
+  EntryArgs& operator%(unsigned v) { return add('u', (uint64_t)v); }
+  EntryArgs& operator%(long v) { return add('i', (int64_t)v); }
+  EntryArgs& operator%(unsigned long v) { return add('u', (uint64_t)v); }
+  EntryArgs& operator%(long long v) { return add('i', (int64_t)v); }
+  EntryArgs& operator%(unsigned long long v) { return add('u', (uint64_t)v); }
+  EntryArgs& operator%(double v) { return add('f', v); }
+  EntryArgs& operator%(const void *v) { return add('p', (uint64_t)(uintptr_t)v); }
+  EntryArgs& operator%(const char *v) {
+    m_entry->add_arg('s', v, v ? strlen(v) : 0);
+    return *this;
+  }
+  EntryArgs& operator%(const std::string& v) {
+    m_entry->add_arg('s', v.data(), v.length());
+    return *this;
+  }
+
+  /// accept the std::flush in dendl
+  EntryArgs& operator<<(std::ostream& (*)(std::ostream&)) {
+    return *this;
+  }
 };
 
 }
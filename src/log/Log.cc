@@ -18,6 +18,9 @@
 
 #define DEFAULT_MAX_NEW    100
 #define DEFAULT_MAX_RECENT 10000
+#define DEFAULT_MAX_FREE   1000
+
+#define MAX_WRITE_BATCH    65536
 
 #define PREALLOC 1000000
 
@@ -39,13 +42,17 @@ Log::Log(SubsystemMap *s)
     m_subs(s),
     m_queue_mutex_holder(0),
     m_flush_mutex_holder(0),
+    m_submitted(NULL), m_submitted_len(0),
     m_new(), m_recent(),
+    m_free_lock(SIMPLE_SPINLOCK_INITIALIZER), m_free(),
     m_fd(-1),
     m_syslog_log(-2), m_syslog_crash(-2),
     m_stderr_log(1), m_stderr_crash(-1),
     m_stop(false),
     m_max_new(DEFAULT_MAX_NEW),
     m_max_recent(DEFAULT_MAX_RECENT),
+    m_max_free(DEFAULT_MAX_FREE),
+    m_binary(false),
     m_inject_segv(false)
 {
   int ret;
@@ -78,6 +85,13 @@ Log::~Log()
   if (m_fd >= 0)
     VOID_TEMP_FAILURE_RETRY(::close(m_fd));
 
+  // entries submitted but never flushed
+  while (m_submitted) {
+    Entry *e = m_submitted;
+    m_submitted = e->m_next;
+    delete e;
+  }
+
   pthread_mutex_destroy(&m_queue_mutex);
   pthread_mutex_destroy(&m_flush_mutex);
   pthread_cond_destroy(&m_cond_loggers);
@@ -109,6 +123,13 @@ void Log::set_max_recent(int n)
   m_max_recent = n;
 }
 
+void Log::set_log_binary(bool b)
+{
+  pthread_mutex_lock(&m_flush_mutex);
+  m_binary = b;
+  pthread_mutex_unlock(&m_flush_mutex);
+}
+
 void Log::set_log_file(string fn)
 {
   m_log_file = fn;
@@ -143,37 +164,98 @@ void Log::set_stderr_level(int log, int crash)
 
 void Log::submit_entry(Entry *e)
 {
-  pthread_mutex_lock(&m_queue_mutex);
-  m_queue_mutex_holder = pthread_self();
-
   if (m_inject_segv)
     *(int *)(0) = 0xdead;
 
   // wait for flush to catch up
-  while (m_new.m_len > m_max_new)
-    pthread_cond_wait(&m_cond_loggers, &m_queue_mutex);
+  if (m_submitted_len > m_max_new) {
+    pthread_mutex_lock(&m_queue_mutex);
+    m_queue_mutex_holder = pthread_self();
+    while (m_submitted_len > m_max_new)
+      pthread_cond_wait(&m_cond_loggers, &m_queue_mutex);
+    m_queue_mutex_holder = 0;
+    pthread_mutex_unlock(&m_queue_mutex);
+  }
 
-  m_new.enqueue(e);
-  pthread_cond_signal(&m_cond_flusher);
-  m_queue_mutex_holder = 0;
-  pthread_mutex_unlock(&m_queue_mutex);
+  // push without taking the queue lock; the flusher takes the whole
+  // list at once.
+  Entry *head;
+  do {
+    head = m_submitted;
+    e->m_next = head;
+  } while (!__sync_bool_compare_and_swap(&m_submitted, head, e));
+  __sync_add_and_fetch(&m_submitted_len, 1);
+
+  // only the push onto an empty list needs to wake the flusher
+  if (!head) {
+    pthread_mutex_lock(&m_queue_mutex);
+    pthread_cond_signal(&m_cond_flusher);
+    pthread_mutex_unlock(&m_queue_mutex);
+  }
 }
 
 Entry *Log::create_entry(int level, int subsys)
 {
-  if (true) {
-    return new Entry(ceph_clock_now(NULL),
+  Entry *e = NULL;
+  if (!m_free.empty()) {
+    simple_spin_lock(&m_free_lock);
+    e = m_free.dequeue();
+    simple_spin_unlock(&m_free_lock);
+  }
+  if (e) {
+    e->reset(ceph_clock_now(NULL), pthread_self(), level, subsys);
+    return e;
+  }
+  return new Entry(ceph_clock_now(NULL),
 		   pthread_self(),
 		   level, subsys);
-  } else {
-    // kludge for perf testing
-    Entry *e = m_recent.dequeue();
-    e->m_stamp = ceph_clock_now(NULL);
-    e->m_thread = pthread_self();
-    e->m_prio = level;
-    e->m_subsys = subsys;
-    return e;
+}
+
+/**
+ * move submitted entries onto m_new, oldest first
+ *
+ * Must hold m_queue_mutex.
+ */
+void Log::_take_submitted()
+{
+  Entry *head = __sync_lock_test_and_set(&m_submitted, (Entry *)NULL);
+  if (!head)
+    return;
+
+  // the list is newest first; reverse it
+  Entry *prev = NULL;
+  int n = 0;
+  while (head) {
+    Entry *next = head->m_next;
+    head->m_next = prev;
+    prev = head;
+    head = next;
+    ++n;
   }
+  __sync_sub_and_fetch(&m_submitted_len, n);
+
+  while (prev) {
+    Entry *next = prev->m_next;
+    prev->m_next = NULL;
+    m_new.enqueue(prev);
+    prev = next;
+  }
+}
+
+/**
+ * hand trimmed entries back to create_entry, freeing any beyond
+ * m_max_free
+ */
+void Log::_recycle(EntryQueue *q)
+{
+  simple_spin_lock(&m_free_lock);
+  while (m_free.m_len < m_max_free && !q->empty())
+    m_free.enqueue(q->dequeue());
+  simple_spin_unlock(&m_free_lock);
+
+  Entry *e;
+  while ((e = q->dequeue()) != NULL)
+    delete e;
 }
 
 void Log::flush()
@@ -182,6 +264,7 @@ void Log::flush()
   m_flush_mutex_holder = pthread_self();
   pthread_mutex_lock(&m_queue_mutex);
   m_queue_mutex_holder = pthread_self();
+  _take_submitted();
   EntryQueue t;
   t.swap(m_new);
   pthread_cond_broadcast(&m_cond_loggers);
@@ -190,9 +273,11 @@ void Log::flush()
   _flush(&t, &m_recent, false);
 
   // trim
+  EntryQueue trimmed;
   while (m_recent.m_len > m_max_recent) {
-    delete m_recent.dequeue();
+    trimmed.enqueue(m_recent.dequeue());
   }
+  _recycle(&trimmed);
 
   m_flush_mutex_holder = 0;
   pthread_mutex_unlock(&m_flush_mutex);
@@ -202,6 +287,7 @@ void Log::_flush(EntryQueue *t, EntryQueue *requeue, bool crash)
 {
   Entry *e;
   char buf[80];
+  string wbuf;  // file output, written in batches
   while ((e = t->dequeue()) != NULL) {
     unsigned sub = e->m_subsys;
 
@@ -210,6 +296,18 @@ void Log::_flush(EntryQueue *t, EntryQueue *requeue, bool crash)
     bool do_syslog = m_syslog_crash >= e->m_prio && should_log;
     bool do_stderr = m_stderr_crash >= e->m_prio && should_log;
 
+    // binary records are only written outside of crash dumps, which
+    // are interleaved with plain text messages
+    bool do_binary = do_fd && m_binary && !crash;
+    if (do_binary) {
+      e->encode_binary(&wbuf);
+      if (wbuf.size() >= MAX_WRITE_BATCH) {
+	_write_batch(wbuf);
+	wbuf.clear();
+      }
+      do_fd = false;
+    }
+
     if (do_fd || do_syslog || do_stderr) {
       int buflen = 0;
 
@@ -223,13 +321,13 @@ void Log::_flush(EntryQueue *t, EntryQueue *requeue, bool crash)
       string s = e->get_str();
 
       if (do_fd) {
-	int r = safe_write(m_fd, buf, buflen);
-	if (r >= 0)
-	  r = safe_write(m_fd, s.data(), s.size());
-	if (r >= 0)
-	  r = write(m_fd, "\n", 1);
-	if (r < 0)
-	  cerr << "problem writing to " << m_log_file << ": " << cpp_strerror(r) << std::endl;
+	wbuf.append(buf, buflen);
+	wbuf.append(s);
+	wbuf.append(1, '\n');
+	if (crash || wbuf.size() >= MAX_WRITE_BATCH) {
+	  _write_batch(wbuf);
+	  wbuf.clear();
+	}
       }
 
       if (do_syslog) {
@@ -243,6 +341,15 @@ void Log::_flush(EntryQueue *t, EntryQueue *requeue, bool crash)
 
     requeue->enqueue(e);
   }
+  if (!wbuf.empty())
+    _write_batch(wbuf);
+}
+
+void Log::_write_batch(const string& s)
+{
+  int r = safe_write(m_fd, s.data(), s.size());
+  if (r < 0)
+    cerr << "problem writing to " << m_log_file << ": " << cpp_strerror(r) << std::endl;
 }
 
 void Log::_log_message(const char *s, bool crash)
@@ -271,6 +378,7 @@ void Log::dump_recent()
   pthread_mutex_lock(&m_queue_mutex);
   m_queue_mutex_holder = pthread_self();
 
+  _take_submitted();
   EntryQueue t;
   t.swap(m_new);
 
@@ -333,7 +441,7 @@ void *Log::entry()
   pthread_mutex_lock(&m_queue_mutex);
   m_queue_mutex_holder = pthread_self();
   while (!m_stop) {
-    if (!m_new.empty()) {
+    if (!m_new.empty() || m_submitted) {
       m_queue_mutex_holder = 0;
       pthread_mutex_unlock(&m_queue_mutex);
       flush();
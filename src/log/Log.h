@@ -5,6 +5,7 @@
 #define __CEPH_LOG_LOG_H
 
 #include "common/Thread.h"
+#include "common/simple_spin.h"
 
 #include <pthread.h>
 
@@ -29,9 +30,15 @@ class Log : private Thread
   pthread_t m_queue_mutex_holder;
   pthread_t m_flush_mutex_holder;
 
+  Entry *m_submitted;  ///< entries pushed by submit_entry, newest first
+  int m_submitted_len; ///< length of m_submitted (updated atomically)
+
   EntryQueue m_new;    ///< new entries
   EntryQueue m_recent; ///< recent (less new) entries we've already written at low detail
 
+  simple_spinlock_t m_free_lock;
+  EntryQueue m_free;   ///< trimmed entries kept for reuse by create_entry
+
   std::string m_log_file;
   int m_fd;
 
@@ -40,13 +47,18 @@ class Log : private Thread
 
   bool m_stop;
 
-  int m_max_new, m_max_recent;
+  int m_max_new, m_max_recent, m_max_free;
+
+  bool m_binary;  ///< write binary records to the log file
 
   bool m_inject_segv;
 
   void *entry();
 
+  void _take_submitted();
+  void _recycle(EntryQueue *q);
   void _flush(EntryQueue *q, EntryQueue *requeue, bool crash);
+  void _write_batch(const std::string& s);
 
   void _log_message(const char *s, bool crash);
 
@@ -59,6 +71,7 @@ public:
   void set_max_new(int n);
   void set_max_recent(int n);
   void set_log_file(std::string fn);
+  void set_log_binary(bool b);
   void reopen_log_file();
 
   void flush(); 
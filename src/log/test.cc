@@ -2,7 +2,13 @@
 
 #include "log/Log.h"
 #include "common/Clock.h"
+#include "common/ceph_context.h"
+#include "common/dout.h"
 #include "common/PrebufferedStreambuf.h"
+#include "common/Thread.h"
+
+#include <fstream>
+#include <stdio.h>
 
 using namespace ceph::log;
 
@@ -188,6 +194,171 @@ TEST(Log, ManyGather)
   log.stop();
 }
 
+TEST(Log, ReuseEntries)
+{
+  SubsystemMap subs;
+  subs.add(1, "foo", 20, 1);
+  Log log(&subs);
+  log.set_max_recent(0);
+  log.start();
+
+  Entry *e = log.create_entry(10, 1);
+  ostream os(&e->m_streambuf);
+  os << "first entry, long enough to overflow the preallocated buffer "
+     << "of the log entry so the overflow string is used too";
+  log.submit_entry(e);
+  log.flush();
+
+  // trimmed entries come back through create_entry, emptied
+  Entry *r = log.create_entry(5, 1);
+  ASSERT_EQ(e, r);
+  ASSERT_EQ("", r->get_str());
+  ASSERT_EQ(5, r->m_prio);
+  ostream ros(&r->m_streambuf);
+  ros << "second";
+  ASSERT_EQ("second", r->get_str());
+  log.submit_entry(r);
+
+  log.flush();
+  log.stop();
+}
+
+struct LogWriter : public Thread {
+  Log *log;
+  int id, count;
+  LogWriter(Log *l, int i, int c) : log(l), id(i), count(c) {}
+  void *entry() {
+    for (int i = 0; i < count; i++) {
+      Entry *e = log->create_entry(10, 1);
+      ostream os(&e->m_streambuf);
+      os << "writer " << id << " seq " << i;
+      log->submit_entry(e);
+    }
+    return NULL;
+  }
+};
+
+TEST(Log, ManyThreads)
+{
+  const char *fn = "/tmp/log_many_threads";
+  ::unlink(fn);
+
+  SubsystemMap subs;
+  subs.add(1, "foo", 20, 1);
+  Log log(&subs);
+  log.start();
+  log.set_log_file(fn);
+  log.reopen_log_file();
+
+  const int nthreads = 8, count = 5000;
+  vector<LogWriter*> writers;
+  for (int i = 0; i < nthreads; i++) {
+    writers.push_back(new LogWriter(&log, i, count));
+    writers.back()->create();
+  }
+  for (int i = 0; i < nthreads; i++) {
+    writers[i]->join();
+    delete writers[i];
+  }
+  log.flush();
+  log.stop();
+
+  // every entry is written once, and each writer's entries in order
+  ifstream in(fn);
+  vector<int> next(nthreads, 0);
+  string line;
+  int total = 0;
+  while (getline(in, line)) {
+    size_t p = line.find("writer ");
+    ASSERT_NE(string::npos, p);
+    int id, seq;
+    ASSERT_EQ(2, sscanf(line.c_str() + p, "writer %d seq %d", &id, &seq));
+    ASSERT_EQ(next[id], seq);
+    next[id]++;
+    total++;
+  }
+  ASSERT_EQ(nthreads * count, total);
+  ::unlink(fn);
+}
+
+TEST(Log, DeferredFormat)
+{
+  Entry e(ceph_clock_now(NULL), pthread_self(), 10, 1);
+  e.set_fmt("int %d uint %u hex %x ptr %p str %s dbl %f 100%% %s");
+  EntryArgs(&e) % -5 % 7u % 255 % (void*)0x1234 % string("abc") % 0.5 % "end";
+  ASSERT_EQ("int -5 uint 7 hex ff ptr 0x1234 str abc dbl 0.5 100% end",
+	    e.get_str());
+
+  // missing arguments and overflowing strings
+  Entry f(ceph_clock_now(NULL), pthread_self(), 10, 1);
+  f.set_fmt("%s %d");
+  EntryArgs(&f) % string(200, 'x');
+  string s = f.get_str();
+  ASSERT_EQ(string(CEPH_LOG_ENTRY_PREALLOC - 2, 'x') + " <?> [truncated]", s);
+}
+
+TEST(Log, DeferredFormatMacro)
+{
+  CephContext *cct = (new CephContext(CEPH_ENTITY_TYPE_CLIENT))->get();
+  const char *fn = "/tmp/test_log_fmt";
+  ::unlink(fn);
+  cct->_log->set_log_file(fn);
+  cct->_log->reopen_log_file();
+
+  lgeneric_dout_fmt(cct, 0, "answer %d name %s") % 42 % "foo" << dendl;
+  cct->_log->flush();
+
+  ifstream in(fn);
+  string line;
+  bool found = false;
+  while (getline(in, line)) {
+    if (line.find("answer 42 name foo") != string::npos)
+      found = true;
+  }
+  ASSERT_TRUE(found);
+
+  cct->put();
+  ::unlink(fn);
+}
+
+TEST(Log, BinaryRecords)
+{
+  Entry a(utime_t(1234, 5678), (pthread_t)42, 3, 7, "plain text");
+  Entry b(utime_t(1235, 0), (pthread_t)43, 5, 8);
+  b.set_fmt("op %s len %llu");
+  EntryArgs(&b) % "write" % 4096ull;
+
+  string out;
+  a.encode_binary(&out);
+  b.encode_binary(&out);
+
+  utime_t stamp;
+  uint64_t thread;
+  short prio, subsys;
+  string text;
+  int r = Entry::decode_binary(out.data(), out.size(),
+			       &stamp, &thread, &prio, &subsys, &text);
+  ASSERT_GT(r, 0);
+  ASSERT_EQ(utime_t(1234, 5678), stamp);
+  ASSERT_EQ(42u, thread);
+  ASSERT_EQ(3, prio);
+  ASSERT_EQ(7, subsys);
+  ASSERT_EQ("plain text", text);
+
+  // a partial record needs more data
+  ASSERT_EQ(0, Entry::decode_binary(out.data() + r, 10,
+				    &stamp, &thread, &prio, &subsys, &text));
+  int r2 = Entry::decode_binary(out.data() + r, out.size() - r,
+				&stamp, &thread, &prio, &subsys, &text);
+  ASSERT_EQ((int)out.size(), r + r2);
+  ASSERT_EQ(5, prio);
+  ASSERT_EQ("op write len 4096", text);
+
+  // not a record
+  ASSERT_EQ(-1, Entry::decode_binary("hello\n", 6,
+				     &stamp, &thread, &prio, &subsys, &text));
+}
+
 void do_segv()
 {
   SubsystemMap subs;
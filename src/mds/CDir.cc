@@ -1427,6 +1427,58 @@ void CDir::fetch(MDSInternalContextBase *c, const string& want_dn, bool ignore_a
   _omap_fetch(want_dn);
 }
 
+/*
+ * Reading a single key is only worth it when the dirfrag is big
+ * enough that loading the whole omap would dominate the request.
+ */
+bool CDir::should_fetch_dentry()
+{
+  uint64_t min = g_conf->mds_dir_fetch_dentry_min;
+  if (min == 0)
+    return false;
+  if (state_test(STATE_FETCHING) || state_test(STATE_REJOINUNDEF) ||
+      inode->is_stray())
+    return false;
+  // dirstat covers the whole directory; assume frags split it evenly
+  uint64_t size = inode->get_projected_inode()->dirstat.size();
+  return (size >> frag.bits()) >= min;
+}
+
+void CDir::fetch_dentry(MDSInternalContextBase *c, const string& dname)
+{
+  dout(10) << "fetch_dentry '" << dname << "' on " << *this << dendl;
+
+  assert(is_auth());
+  assert(!is_complete());
+  assert(c);
+
+  if (!can_auth_pin()) {
+    dout(7) << "fetch_dentry waiting for authpinnable" << dendl;
+    add_waiter(WAIT_UNFREEZE, c);
+    return;
+  }
+
+  // a full fetch is already on its way; just wait for it
+  if (state_test(STATE_FETCHING) ||
+      (inode->inode.nlink == 0 && !inode->snaprealm)) {
+    fetch(c, dname);
+    return;
+  }
+
+  add_dentry_waiter(dname, CEPH_NOSNAP, c);
+
+  if (fetching_dentries.count(dname)) {
+    dout(7) << "already fetching '" << dname << "'; waiting" << dendl;
+    return;
+  }
+  fetching_dentries.insert(dname);
+  auth_pin(this);
+
+  if (cache->mds->logger) cache->mds->logger->inc(l_mds_dir_fetch_dentry);
+
+  _omap_fetch_dentry(dname);
+}
+
 class C_IO_Dir_TMAP_Fetched : public CDirIOContext {
  protected:
   string want_dn;
@@ -1521,6 +1573,230 @@ void CDir::_omap_fetch(const string& want_dn)
 			     new C_OnFinisher(fin, &cache->mds->finisher));
 }
 
+class C_IO_Dir_OMAP_Fetched_Dentry : public CDirIOContext {
+ protected:
+  string dname;
+ public:
+  bufferlist hdrbl;
+  map<string, bufferlist> omap;
+  int ret1, ret2;
+
+  C_IO_Dir_OMAP_Fetched_Dentry(CDir *d, const string& n) : CDirIOContext(d), dname(n) { }
+  void finish(int r) {
+    if (r >= 0) r = ret1;
+    if (r >= 0) r = ret2;
+    dir->_omap_fetched_dentry(hdrbl, omap, dname, r);
+  }
+};
+
+void CDir::_omap_fetch_dentry(const string& dname)
+{
+  C_IO_Dir_OMAP_Fetched_Dentry *fin = new C_IO_Dir_OMAP_Fetched_Dentry(this, dname);
+  object_t oid = get_ondisk_object();
+  object_locator_t oloc(cache->mds->mdsmap->get_metadata_pool());
+
+  set<string> keys;
+  string key;
+  dentry_key_t(CEPH_NOSNAP, dname.c_str()).encode(key);
+  keys.insert(key);
+
+  ObjectOperation rd;
+  rd.omap_get_header(&fin->hdrbl, &fin->ret1);
+  rd.omap_get_vals_by_keys(keys, &fin->omap, &fin->ret2);
+  cache->mds->objecter->read(oid, oloc, rd, CEPH_NOSNAP, NULL, 0,
+			     new C_OnFinisher(fin, &cache->mds->finisher));
+}
+
+/*
+ * Load one encoded dentry from the dirfrag object, unless the cache
+ * already has something for it.  Returns the dentry, or NULL if it
+ * was stale or could not be loaded.
+ */
+CDentry *CDir::_load_dentry(const string& key, bufferlist& bl, int pos,
+			    const set<snapid_t> *snaps, bool stray,
+			    version_t ondisk_version, string *pdname,
+			    list<CInode*>& undef_inodes)
+{
+  LogChannelRef clog = cache->mds->clog;
+
+  // dname
+  string dname;
+  snapid_t first, last;
+  dentry_key_t::decode_helper(key, dname, last);
+  *pdname = dname;
+
+  bufferlist::iterator q = bl.begin();
+  ::decode(first, q);
+
+  // marker
+  char type;
+  ::decode(type, q);
+
+  dout(20) << "_fetched pos " << pos << " marker '" << type << "' dname '" << dname
+	   << " [" << first << "," << last << "]"
+	   << dendl;
+
+  bool stale = false;
+  if (snaps && last != CEPH_NOSNAP) {
+    set<snapid_t>::const_iterator p = snaps->lower_bound(first);
+    if (p == snaps->end() || *p > last) {
+      dout(10) << " skipping stale dentry on [" << first << "," << last << "]" << dendl;
+      stale = true;
+    }
+  }
+  
+  /*
+   * look for existing dentry for _last_ snap, because unlink +
+   * create may leave a "hole" (epochs during which the dentry
+   * doesn't exist) but for which no explicit negative dentry is in
+   * the cache.
+   */
+  CDentry *dn = NULL;
+  if (!stale)
+    dn = lookup(dname, last);
+
+  if (type == 'L') {
+    // hard link
+    inodeno_t ino;
+    unsigned char d_type;
+    ::decode(ino, q);
+    ::decode(d_type, q);
+
+    if (stale)
+      return NULL;
+
+    if (dn) {
+      if (dn->get_linkage()->get_inode() == 0) {
+	dout(12) << "_fetched  had NEG dentry " << *dn << dendl;
+      } else {
+	dout(12) << "_fetched  had dentry " << *dn << dendl;
+      }
+    } else {
+      // (remote) link
+      dn = add_remote_dentry(dname, ino, d_type, first, last);
+      
+      // link to inode?
+      CInode *in = cache->get_inode(ino);   // we may or may not have it.
+      if (in) {
+	dn->link_remote(dn->get_linkage(), in);
+	dout(12) << "_fetched  got remote link " << ino << " which we have " << *in << dendl;
+      } else {
+	dout(12) << "_fetched  got remote link " << ino << " (dont' have it)" << dendl;
+      }
+    }
+  } 
+  else if (type == 'I') {
+    // inode
+    
+    // Load inode data before looking up or constructing CInode
+    InodeStore inode_data;
+    inode_data.decode_bare(q);
+    
+    if (stale)
+      return NULL;
+
+    bool undef_inode = false;
+    if (dn) {
+      CInode *in = dn->get_linkage()->get_inode();
+      if (in) {
+	dout(12) << "_fetched  had dentry " << *dn << dendl;
+	if (in->state_test(CInode::STATE_REJOINUNDEF)) {
+	  undef_inodes.push_back(in);
+	  undef_inode = true;
+	}
+      } else
+	dout(12) << "_fetched  had NEG dentry " << *dn << dendl;
+    }
+
+    if (!dn || undef_inode) {
+      // add inode
+      CInode *in = cache->get_inode(inode_data.inode.ino, last);
+      if (!in || undef_inode) {
+	if (undef_inode && in)
+	  in->first = first;
+	else
+	  in = new CInode(cache, true, first, last);
+	
+	in->inode = inode_data.inode;
+	// symlink?
+	if (in->is_symlink()) 
+	  in->symlink = inode_data.symlink;
+	
+	in->dirfragtree.swap(inode_data.dirfragtree);
+	in->xattrs.swap(inode_data.xattrs);
+	in->old_inodes.swap(inode_data.old_inodes);
+	in->oldest_snap = inode_data.oldest_snap;
+	in->decode_snap_blob(inode_data.snap_blob);
+	if (snaps && !in->snaprealm)
+	  in->purge_stale_snap_data(*snaps);
+
+	if (!undef_inode) {
+	  cache->add_inode(in); // add
+	  dn = add_primary_dentry(dname, in, first, last); // link
+	}
+	dout(12) << "_fetched  got " << *dn << " " << *in << dendl;
+
+	if (in->inode.is_dirty_rstat())
+	  in->mark_dirty_rstat();
+
+	if (stray) {
+	  dn->state_set(CDentry::STATE_STRAY);
+	  if (in->inode.nlink == 0)
+	    in->state_set(CInode::STATE_ORPHAN);
+	}
+
+	//in->hack_accessed = false;
+	//in->hack_load_stamp = ceph_clock_now(g_ceph_context);
+	//num_new_inodes_loaded++;
+      } else {
+	dout(0) << "_fetched  badness: got (but i already had) " << *in
+		<< " mode " << in->inode.mode
+		<< " mtime " << in->inode.mtime << dendl;
+	string dirpath, inopath;
+	this->inode->make_path_string(dirpath);
+	in->make_path_string(inopath);
+	clog->error() << "loaded dup inode " << inode_data.inode.ino
+	  << " [" << first << "," << last << "] v" << inode_data.inode.version
+	  << " at " << dirpath << "/" << dname
+	  << ", but inode " << in->vino() << " v" << in->inode.version
+	  << " already exists at " << inopath << "\n";
+	return NULL;
+      }
+    }
+  } else {
+    dout(1) << "corrupt directory, i got tag char '" << type << "' pos " << pos << dendl;
+    assert(0);
+  }
+
+  /** clean underwater item?
+   * Underwater item is something that is dirty in our cache from
+   * journal replay, but was previously flushed to disk before the
+   * mds failed.
+   *
+   * We only do this is committed_version == 0. that implies either
+   * - this is a fetch after from a clean/empty CDir is created
+   *   (and has no effect, since the dn won't exist); or
+   * - this is a fetch after _recovery_, which is what we're worried 
+   *   about.  Items that are marked dirty from the journal should be
+   *   marked clean if they appear on disk.
+   */
+  if (committed_version == 0 &&     
+      dn &&
+      dn->get_version() <= ondisk_version &&
+      dn->is_dirty()) {
+    dout(10) << "_fetched  had underwater dentry " << *dn << ", marking clean" << dendl;
+    dn->mark_clean();
+
+    if (dn->get_linkage()->is_primary()) {
+      assert(dn->get_linkage()->get_inode()->get_version() <= ondisk_version);
+      dout(10) << "_fetched  had underwater inode " << *dn->get_linkage()->get_inode() << ", marking clean" << dendl;
+      dn->get_linkage()->get_inode()->mark_clean();
+    }
+  }
+
+  return dn;
+}
+
 void CDir::_omap_fetched(bufferlist& hdrbl, map<string, bufferlist>& omap,
 			 const string& want_dn, int r)
 {
@@ -1603,184 +1879,14 @@ void CDir::_omap_fetched(bufferlist& hdrbl, map<string, bufferlist>& omap,
   for (map<string, bufferlist>::reverse_iterator p = omap.rbegin();
        p != omap.rend();
        ++p, --pos) {
-    // dname
     string dname;
-    snapid_t first, last;
-    dentry_key_t::decode_helper(p->first, dname, last);
-    
-    bufferlist::iterator q = p->second.begin();
-    ::decode(first, q);
-
-    // marker
-    char type;
-    ::decode(type, q);
-
-    dout(20) << "_fetched pos " << pos << " marker '" << type << "' dname '" << dname
-	     << " [" << first << "," << last << "]"
-	     << dendl;
-
-    bool stale = false;
-    if (snaps && last != CEPH_NOSNAP) {
-      set<snapid_t>::const_iterator p = snaps->lower_bound(first);
-      if (p == snaps->end() || *p > last) {
-	dout(10) << " skipping stale dentry on [" << first << "," << last << "]" << dendl;
-	stale = true;
-      }
-    }
-    
-    /*
-     * look for existing dentry for _last_ snap, because unlink +
-     * create may leave a "hole" (epochs during which the dentry
-     * doesn't exist) but for which no explicit negative dentry is in
-     * the cache.
-     */
-    CDentry *dn = NULL;
-    if (!stale)
-      dn = lookup(dname, last);
-
-    if (type == 'L') {
-      // hard link
-      inodeno_t ino;
-      unsigned char d_type;
-      ::decode(ino, q);
-      ::decode(d_type, q);
-
-      if (stale)
-	continue;
-
-      if (dn) {
-        if (dn->get_linkage()->get_inode() == 0) {
-          dout(12) << "_fetched  had NEG dentry " << *dn << dendl;
-        } else {
-          dout(12) << "_fetched  had dentry " << *dn << dendl;
-        }
-      } else {
-	// (remote) link
-	dn = add_remote_dentry(dname, ino, d_type, first, last);
-	
-	// link to inode?
-	CInode *in = cache->get_inode(ino);   // we may or may not have it.
-	if (in) {
-	  dn->link_remote(dn->get_linkage(), in);
-	  dout(12) << "_fetched  got remote link " << ino << " which we have " << *in << dendl;
-	} else {
-	  dout(12) << "_fetched  got remote link " << ino << " (dont' have it)" << dendl;
-	}
-      }
-    } 
-    else if (type == 'I') {
-      // inode
-      
-      // Load inode data before looking up or constructing CInode
-      InodeStore inode_data;
-      inode_data.decode_bare(q);
-      
-      if (stale)
-	continue;
-
-      bool undef_inode = false;
-      if (dn) {
-	CInode *in = dn->get_linkage()->get_inode();
-	if (in) {
-	  dout(12) << "_fetched  had dentry " << *dn << dendl;
-	  if (in->state_test(CInode::STATE_REJOINUNDEF)) {
-	    undef_inodes.push_back(in);
-	    undef_inode = true;
-	  }
-	} else
-	  dout(12) << "_fetched  had NEG dentry " << *dn << dendl;
-      }
-
-      if (!dn || undef_inode) {
-	// add inode
-	CInode *in = cache->get_inode(inode_data.inode.ino, last);
-	if (!in || undef_inode) {
-	  if (undef_inode && in)
-	    in->first = first;
-	  else
-	    in = new CInode(cache, true, first, last);
-	  
-	  in->inode = inode_data.inode;
-	  // symlink?
-	  if (in->is_symlink()) 
-	    in->symlink = inode_data.symlink;
-	  
-	  in->dirfragtree.swap(inode_data.dirfragtree);
-	  in->xattrs.swap(inode_data.xattrs);
-	  in->old_inodes.swap(inode_data.old_inodes);
-	  in->oldest_snap = inode_data.oldest_snap;
-	  in->decode_snap_blob(inode_data.snap_blob);
-	  if (snaps && !in->snaprealm)
-	    in->purge_stale_snap_data(*snaps);
-
-	  if (!undef_inode) {
-	    cache->add_inode(in); // add
-	    dn = add_primary_dentry(dname, in, first, last); // link
-	  }
-	  dout(12) << "_fetched  got " << *dn << " " << *in << dendl;
-
-	  if (in->inode.is_dirty_rstat())
-	    in->mark_dirty_rstat();
-
-	  if (stray) {
-	    dn->state_set(CDentry::STATE_STRAY);
-	    if (in->inode.nlink == 0)
-	      in->state_set(CInode::STATE_ORPHAN);
-	  }
-
-	  //in->hack_accessed = false;
-	  //in->hack_load_stamp = ceph_clock_now(g_ceph_context);
-	  //num_new_inodes_loaded++;
-	} else {
-	  dout(0) << "_fetched  badness: got (but i already had) " << *in
-		  << " mode " << in->inode.mode
-		  << " mtime " << in->inode.mtime << dendl;
-	  string dirpath, inopath;
-	  this->inode->make_path_string(dirpath);
-	  in->make_path_string(inopath);
-	  clog->error() << "loaded dup inode " << inode_data.inode.ino
-	    << " [" << first << "," << last << "] v" << inode_data.inode.version
-	    << " at " << dirpath << "/" << dname
-	    << ", but inode " << in->vino() << " v" << in->inode.version
-	    << " already exists at " << inopath << "\n";
-	  continue;
-	}
-      }
-    } else {
-      dout(1) << "corrupt directory, i got tag char '" << type << "' pos " << pos << dendl;
-      assert(0);
-    }
+    CDentry *dn = _load_dentry(p->first, p->second, pos, snaps, stray,
+			       got_fnode.version, &dname, undef_inodes);
     
     if (dn && want_dn.length() && want_dn == dname) {
       dout(10) << " touching wanted dn " << *dn << dendl;
       inode->mdcache->touch_dentry(dn);
     }
-
-    /** clean underwater item?
-     * Underwater item is something that is dirty in our cache from
-     * journal replay, but was previously flushed to disk before the
-     * mds failed.
-     *
-     * We only do this is committed_version == 0. that implies either
-     * - this is a fetch after from a clean/empty CDir is created
-     *   (and has no effect, since the dn won't exist); or
-     * - this is a fetch after _recovery_, which is what we're worried 
-     *   about.  Items that are marked dirty from the journal should be
-     *   marked clean if they appear on disk.
-     */
-    if (committed_version == 0 &&     
-	dn &&
-	dn->get_version() <= got_fnode.version &&
-	dn->is_dirty()) {
-      dout(10) << "_fetched  had underwater dentry " << *dn << ", marking clean" << dendl;
-      dn->mark_clean();
-
-      if (dn->get_linkage()->is_primary()) {
-	assert(dn->get_linkage()->get_inode()->get_version() <= got_fnode.version);
-	dout(10) << "_fetched  had underwater inode " << *dn->get_linkage()->get_inode() << ", marking clean" << dendl;
-	dn->get_linkage()->get_inode()->mark_clean();
-      }
-    }
   }
 
   //cache->mds->logger->inc("newin", num_new_inodes_loaded);
@@ -1803,6 +1909,77 @@ void CDir::_omap_fetched(bufferlist& hdrbl, map<string, bufferlist>& omap,
   finish_waiting(WAIT_COMPLETE, 0);
 }
 
+void CDir::_omap_fetched_dentry(bufferlist& hdrbl, map<string, bufferlist>& omap,
+				const string& dname, int r)
+{
+  dout(10) << "_fetched_dentry '" << dname << "' header " << hdrbl.length()
+	   << " bytes " << omap.size() << " keys for " << *this << dendl;
+
+  assert(is_auth());
+  assert(!is_frozen());
+  fetching_dentries.erase(dname);
+
+  list<MDSInternalContextBase*> finished;
+  take_dentry_waiting(dname, CEPH_NOSNAP, CEPH_NOSNAP, finished);
+
+  if (!is_complete()) {
+    if (r < 0 || hdrbl.length() == 0 || state_test(STATE_REJOINUNDEF)) {
+      // old tmap object, missing object, or a dirfrag we know nothing
+      // about: let the full fetch sort it out.
+      dout(10) << "_fetched_dentry r=" << r << ", falling back to full fetch" << dendl;
+      while (!finished.empty()) {
+	fetch(finished.front(), dname, true);
+	finished.pop_front();
+      }
+      auth_unpin(this);
+      return;
+    }
+
+    fnode_t got_fnode;
+    bufferlist::iterator p = hdrbl.begin();
+    ::decode(got_fnode, p);
+
+    if (get_version() == 0) {
+      assert(!is_projected());
+      assert(!state_test(STATE_COMMITTING));
+      fnode = got_fnode;
+      projected_version = committing_version = committed_version = got_fnode.version;
+    }
+
+    // only the head key was requested, so there is nothing for the
+    // snap purge to trim; leave that to the next full fetch.
+    list<CInode*> undef_inodes;
+    CDentry *dn = NULL;
+    if (!omap.empty()) {
+      string got;
+      dn = _load_dentry(omap.begin()->first, omap.begin()->second, 0, NULL,
+			inode->is_stray(), got_fnode.version, &got, undef_inodes);
+    } else {
+      dn = lookup(dname, CEPH_NOSNAP);
+      if (!dn) {
+	// remember the miss so repeated lookups stay in cache.  only the
+	// head key was read, so the null dentry must not cover snapshots
+	// that may still hold an older version of the name.
+	snapid_t first = inode->find_snaprealm()->get_newest_seq() + 1;
+	dn = add_null_dentry(dname, first);
+	dout(12) << "_fetched_dentry  not on disk, added " << *dn << dendl;
+      }
+    }
+    if (dn)
+      inode->mdcache->touch_dentry(dn);
+
+    while (!undef_inodes.empty()) {
+      CInode *in = undef_inodes.front();
+      undef_inodes.pop_front();
+      in->state_clear(CInode::STATE_REJOINUNDEF);
+      cache->opened_undef_inode(in);
+    }
+  }
+
+  auth_unpin(this);
+  cache->mds->queue_waiters(finished);
+}
+
 
 
 // -----------------------
@@ -290,6 +290,7 @@ protected:
   friend class CDirExport;
   friend class C_IO_Dir_TMAP_Fetched;
   friend class C_IO_Dir_OMAP_Fetched;
+  friend class C_IO_Dir_OMAP_Fetched_Dentry;
   friend class C_IO_Dir_Committed;
 
   bloom_filter *bloom;
@@ -497,8 +498,18 @@ private:
   }
   void fetch(MDSInternalContextBase *c, bool ignore_authpinnability=false);
   void fetch(MDSInternalContextBase *c, const std::string& want_dn, bool ignore_authpinnability=false);
+  bool should_fetch_dentry();
+  void fetch_dentry(MDSInternalContextBase *c, const std::string& dname);
 protected:
+  compact_set<std::string> fetching_dentries;  // single-dentry reads in flight
   void _omap_fetch(const std::string& want_dn);
+  void _omap_fetch_dentry(const std::string& dname);
+  void _omap_fetched_dentry(bufferlist& hdrbl, std::map<std::string, bufferlist>& omap,
+			    const std::string& dname, int r);
+  CDentry *_load_dentry(const std::string& key, bufferlist& bl, int pos,
+			const std::set<snapid_t> *snaps, bool stray,
+			version_t ondisk_version, std::string *pdname,
+			std::list<CInode*>& undef_inodes);
   void _omap_fetched(bufferlist& hdrbl, std::map<std::string, bufferlist>& omap,
 		     const std::string& want_dn, int r);
   void _tmap_fetch(const std::string& want_dn);
@@ -24,6 +24,7 @@
 
 #include "MDLog.h"
 #include "MDSMap.h"
+#include "MDBalancer.h"
 
 #include "events/EUpdate.h"
 #include "events/EOpen.h"
@@ -497,8 +498,10 @@ bool Locker::acquire_locks(MDRequestRef& mdr,
     }
     if (xlocks.count(*p)) {
       marker.message = "failed to xlock, waiting";
-      if (!xlock_start(*p, mdr)) 
+      if (!xlock_start(*p, mdr)) {
+	mds->balancer->hit_lock_wait(*p);
 	goto out;
+      }
       dout(10) << " got xlock on " << **p << " " << *(*p)->get_parent() << dendl;
     } else if (need_wrlock || need_remote_wrlock) {
       if (need_remote_wrlock && !mdr->remote_wrlocks.count(*p)) {
@@ -516,14 +519,18 @@ bool Locker::acquire_locks(MDRequestRef& mdr,
 	  remote_wrlock_start(*p, (*remote_wrlocks)[*p], mdr);
 	  goto out;
 	}
-	if (!wrlock_start(*p, mdr))
+	if (!wrlock_start(*p, mdr)) {
+	  mds->balancer->hit_lock_wait(*p);
 	  goto out;
+	}
 	dout(10) << " got wrlock on " << **p << " " << *(*p)->get_parent() << dendl;
       }
     } else {
       marker.message = "failed to rdlock, waiting";
-      if (!rdlock_start(*p, mdr)) 
+      if (!rdlock_start(*p, mdr)) {
+	mds->balancer->hit_lock_wait(*p);
 	goto out;
+      }
       dout(10) << " got rdlock on " << **p << " " << *(*p)->get_parent() << dendl;
     }
   }
@@ -1929,6 +1936,7 @@ bool Locker::issue_caps(CInode *in, Capability *only_cap)
 
 	int op = (before & ~after) ? CEPH_CAP_OP_REVOKE : CEPH_CAP_OP_GRANT;
 	if (op == CEPH_CAP_OP_REVOKE) {
+		if (mds->logger) mds->logger->inc(l_mds_cap_revoke);
 		revoking_caps.push_back(&cap->item_revoking_caps);
 		revoking_caps_by_client[cap->get_client()].push_back(&cap->item_client_revoking_caps);
 		cap->set_last_revoke_stamp(ceph_clock_now(g_ceph_context));
@@ -3151,9 +3159,16 @@ void Locker::handle_client_cap_release(MClientCapRelease *m)
 
   Session *session = static_cast<Session *>(m->get_connection()->get_priv());
 
+  // a trimming client releases caps in bulk, often several on the same
+  // inode; evaluate locks and reissue once per inode for the batch.
+  set<CInode*> eval_set, issue_set;
   for (vector<ceph_mds_cap_item>::iterator p = m->caps.begin(); p != m->caps.end(); ++p) {
-    _do_cap_release(client, inodeno_t((uint64_t)p->ino) , p->cap_id, p->migrate_seq, p->seq);
+    _do_cap_release(client, inodeno_t((uint64_t)p->ino) , p->cap_id, p->migrate_seq, p->seq,
+		    &eval_set, &issue_set);
   }
+  finish_cap_batch(eval_set, issue_set);
+  if (mds->logger)
+    mds->logger->inc(l_mds_cap_release_batch, m->caps.size());
 
   if (session) {
     session->notify_cap_release(m->caps.size());
@@ -3178,7 +3193,8 @@ public:
 };
 
 void Locker::_do_cap_release(client_t client, inodeno_t ino, uint64_t cap_id,
-			     ceph_seq_t mseq, ceph_seq_t seq)
+			     ceph_seq_t mseq, ceph_seq_t seq,
+			     set<CInode*> *eval_set, set<CInode*> *issue_set)
 {
   CInode *in = mdcache->get_inode(ino);
   if (!in) {
@@ -3210,15 +3226,46 @@ void Locker::_do_cap_release(client_t client, inodeno_t ino, uint64_t cap_id,
     dout(7) << " issue_seq " << seq << " != " << cap->get_last_issue() << dendl;
     // clean out any old revoke history
     cap->clean_revoke_from(seq);
-    eval_cap_gather(in);
+    if (issue_set && in->is_head()) {
+      set<CInode*> issue;
+      eval_cap_gather(in, &issue);
+      if (!issue.empty() && issue_set->insert(in).second)
+	in->get(CInode::PIN_PTRWAITER);
+    } else {
+      eval_cap_gather(in);
+    }
     return;
   }
-  remove_client_cap(in, client);
+  if (mds->logger) mds->logger->inc(l_mds_cap_release);
+  remove_client_cap(in, client, eval_set);
+}
+
+/*
+ * Finish a batch of cap releases: evaluate the locks of each inode
+ * that lost a cap once, then reissue once on each inode whose
+ * revocations completed.  Both sets hold a pin on their inodes.
+ */
+void Locker::finish_cap_batch(set<CInode*>& eval_set, set<CInode*>& issue_set)
+{
+  dout(10) << "finish_cap_batch eval " << eval_set.size()
+	   << " issue " << issue_set.size() << dendl;
+
+  for (set<CInode*>::iterator p = eval_set.begin(); p != eval_set.end(); ++p)
+    try_eval(*p, CEPH_CAP_LOCKS);
+  for (set<CInode*>::iterator p = issue_set.begin(); p != issue_set.end(); ++p)
+    issue_caps(*p);
+
+  for (set<CInode*>::iterator p = eval_set.begin(); p != eval_set.end(); ++p)
+    (*p)->put(CInode::PIN_PTRWAITER);
+  for (set<CInode*>::iterator p = issue_set.begin(); p != issue_set.end(); ++p)
+    (*p)->put(CInode::PIN_PTRWAITER);
+  eval_set.clear();
+  issue_set.clear();
 }
 
 /* This function DOES put the passed message before returning */
 
-void Locker::remove_client_cap(CInode *in, client_t client)
+void Locker::remove_client_cap(CInode *in, client_t client, set<CInode*> *eval_set)
 {
   // clean out any pending snapflush state
   if (!in->client_need_snapflush.empty())
@@ -3235,7 +3282,12 @@ void Locker::remove_client_cap(CInode *in, client_t client)
     request_inode_file_caps(in);
   }
   
-  try_eval(in, CEPH_CAP_LOCKS);
+  if (eval_set) {
+    if (eval_set->insert(in).second)
+      in->get(CInode::PIN_PTRWAITER);
+  } else {
+    try_eval(in, CEPH_CAP_LOCKS);
+  }
 }
 
 
@@ -183,7 +183,8 @@ public:
   void kick_cap_releases(MDRequestRef& mdr);
   void kick_issue_caps(CInode *in, client_t client, ceph_seq_t seq);
 
-  void remove_client_cap(CInode *in, client_t client);
+  void remove_client_cap(CInode *in, client_t client, set<CInode*> *eval_set=NULL);
+  void finish_cap_batch(set<CInode*>& eval_set, set<CInode*>& issue_set);
 
   void get_late_revoking_clients(std::list<client_t> *result) const;
   bool any_late_revoking_caps(xlist<Capability*> const &revoking) const;
@@ -197,7 +198,8 @@ public:
   bool _do_cap_update(CInode *in, Capability *cap, int dirty, snapid_t follows, MClientCaps *m,
 		      MClientCaps *ack=0);
   void handle_client_cap_release(class MClientCapRelease *m);
-  void _do_cap_release(client_t client, inodeno_t ino, uint64_t cap_id, ceph_seq_t mseq, ceph_seq_t seq);
+  void _do_cap_release(client_t client, inodeno_t ino, uint64_t cap_id, ceph_seq_t mseq, ceph_seq_t seq,
+		       set<CInode*> *eval_set=NULL, set<CInode*> *issue_set=NULL);
   void caps_tick();
 
   // Maintain a global list to quickly find if any caps are late revoking
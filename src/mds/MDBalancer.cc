@@ -22,8 +22,11 @@
 #include "CDir.h"
 #include "MDCache.h"
 #include "Migrator.h"
+#include "CDentry.h"
+#include "SimpleLock.h"
 
 #include "include/Context.h"
+#include "common/Formatter.h"
 #include "msg/Messenger.h"
 #include "messages/MHeartbeat.h"
 #include "messages/MMDSLoadTargets.h"
@@ -343,6 +346,9 @@ void MDBalancer::queue_merge(CDir *dir)
 
 void MDBalancer::do_fragmenting()
 {
+  if (g_conf->mds_bal_frag)
+    evaluate_fragments(ceph_clock_now(g_ceph_context));
+
   if (split_queue.empty() && merge_queue.empty()) {
     dout(20) << "do_fragmenting has nothing to do" << dendl;
     return;
@@ -419,6 +425,186 @@ void MDBalancer::do_fragmenting()
 
 
 
+/*
+ * Decide what to do with each auth dirfrag that saw traffic since the
+ * last pass.  Besides the static size and popularity thresholds we
+ * look at how fast the frag is growing and at how often requests had
+ * to wait on its locks, so that a directory under a create storm is
+ * split before it gets big rather than after.
+ */
+void MDBalancer::evaluate_fragments(utime_t now)
+{
+  const DecayRate& rate = mds->mdcache->decayrate;
+  // splitting freezes the frag and rewrites all of its dentries; don't
+  // pay for that if the children would qualify for a merge right away.
+  uint64_t min_split = (1ull << g_conf->mds_bal_split_bits) * g_conf->mds_bal_merge_size;
+  bool exported = false;
+
+  map<dirfrag_t, frag_sample_t>::iterator p = frag_samples.begin();
+  while (p != frag_samples.end()) {
+    map<dirfrag_t, frag_sample_t>::iterator cur = p++;
+    frag_sample_t& sample = cur->second;
+    CDir *dir = mds->mdcache->get_dirfrag(cur->first);
+    if (!dir || !dir->is_auth() || !sample.hit) {
+      frag_samples.erase(cur);
+      continue;
+    }
+
+    double elapsed = MAX((double)(now - sample.stamp), 1.0);
+    uint64_t size = dir->get_frag_size();
+    double rd = dir->pop_me.get(META_POP_IRD).get(now, rate);
+    double wr = dir->pop_me.get(META_POP_IWR).get(now, rate);
+    double growth = ((double)size - (double)sample.size) / elapsed;
+    double waits = (double)sample.lock_waits / elapsed;
+    sample.stamp = now;
+    sample.size = size;
+    sample.lock_waits = 0;
+    sample.hit = false;
+
+    dout(20) << "evaluate_fragments " << *dir << " size " << size
+	     << " growth " << growth << "/s rd " << rd << " wr " << wr
+	     << " lock waits " << waits << "/s" << dendl;
+
+    if (dir->state_test(CDir::STATE_FRAGMENTING) ||
+	dir->is_freezing() || dir->is_frozen())
+      continue;
+
+    // split?
+    const char *why = NULL;
+    if (g_conf->mds_bal_split_size > 0 && size >= min_split) {
+      if (dir->should_split())
+	why = "size";
+      else if (growth > 0 &&
+	       size + growth * g_conf->mds_bal_split_horizon > (double)g_conf->mds_bal_split_size)
+	why = "growth";
+      else if (wr > g_conf->mds_bal_split_wr)
+	why = "write load";
+      else if (rd > g_conf->mds_bal_split_rd)
+	why = "read load";
+      else if (g_conf->mds_bal_split_contention > 0 &&
+	       waits > g_conf->mds_bal_split_contention)
+	why = "lock contention";
+    }
+    if (why) {
+      if (split_queue.insert(dir->dirfrag()).second)
+	note_frag_decision(now, dir, "split", why, rd, wr, growth, waits);
+      continue;
+    }
+
+    // merge?
+    if (dir->get_frag() != frag_t() && dir->should_merge() &&
+	rd < g_conf->mds_bal_merge_rd && wr < g_conf->mds_bal_merge_wr &&
+	waits == 0) {
+      if (merge_queue.insert(dir->dirfrag()).second)
+	note_frag_decision(now, dir, "merge", "cold", rd, wr, growth, waits);
+      continue;
+    }
+
+    // spread the hot fragments of an already split directory over the
+    // other active ranks, one per pass.
+    if (!exported && g_conf->mds_bal_frag_export &&
+	dir->get_frag() != frag_t() &&
+	!dir->inode->is_stray() &&
+	(wr > g_conf->mds_bal_split_wr / 2 ||
+	 rd > g_conf->mds_bal_split_rd / 2)) {
+      mds_rank_t target = pick_frag_export_target();
+      if (target != MDS_RANK_NONE) {
+	note_frag_decision(now, dir, "export", "hot fragment", rd, wr, growth,
+			   waits, target);
+	mds->mdcache->migrator->export_dir_nicely(dir, target);
+	exported = true;
+      }
+    }
+  }
+}
+
+mds_rank_t MDBalancer::pick_frag_export_target()
+{
+  set<mds_rank_t> active;
+  mds->mdsmap->get_active_mds_set(active);
+  active.erase(mds->get_nodeid());
+  if (active.empty() || mds->mdsmap->is_degraded())
+    return MDS_RANK_NONE;
+
+  // least loaded rank we have heard from; ranks we know nothing about
+  // count as idle.
+  mds_rank_t best = MDS_RANK_NONE;
+  double best_load = 0;
+  for (set<mds_rank_t>::iterator p = active.begin(); p != active.end(); ++p) {
+    double load = 0;
+    map<mds_rank_t, mds_load_t>::iterator q = mds_load.find(*p);
+    if (q != mds_load.end())
+      load = q->second.mds_load();
+    if (best == MDS_RANK_NONE || load < best_load) {
+      best = *p;
+      best_load = load;
+    }
+  }
+  return best;
+}
+
+void MDBalancer::note_frag_decision(utime_t now, CDir *dir, const char *action,
+				    const char *reason, double rd, double wr,
+				    double growth, double waits, mds_rank_t target)
+{
+  dout(10) << "evaluate_fragments " << action << " (" << reason << ") "
+	   << *dir << dendl;
+
+  if (mds->logger) {
+    if (strcmp(action, "split") == 0)
+      mds->logger->inc(l_mds_frag_split);
+    else if (strcmp(action, "merge") == 0)
+      mds->logger->inc(l_mds_frag_merge);
+    else
+      mds->logger->inc(l_mds_frag_export);
+  }
+
+  frag_decision_t d;
+  d.stamp = now;
+  d.dirfrag = dir->dirfrag();
+  d.action = action;
+  d.reason = reason;
+  d.size = dir->get_frag_size();
+  d.rd = rd;
+  d.wr = wr;
+  d.growth = growth;
+  d.waits = waits;
+  d.target = target;
+  frag_history.push_back(d);
+  while ((int)frag_history.size() > g_conf->mds_bal_frag_history)
+    frag_history.pop_front();
+}
+
+void MDBalancer::frag_decision_t::dump(Formatter *f) const
+{
+  f->dump_stream("stamp") << stamp;
+  f->dump_stream("dirfrag") << dirfrag;
+  f->dump_string("action", action);
+  f->dump_string("reason", reason);
+  f->dump_unsigned("size", size);
+  f->dump_float("rd", rd);
+  f->dump_float("wr", wr);
+  f->dump_float("growth", growth);
+  f->dump_float("lock_waits", waits);
+  if (target != MDS_RANK_NONE)
+    f->dump_int("target", target);
+}
+
+void MDBalancer::dump_frag_history(Formatter *f) const
+{
+  f->open_array_section("decisions");
+  for (list<frag_decision_t>::const_iterator p = frag_history.begin();
+       p != frag_history.end();
+       ++p) {
+    f->open_object_section("decision");
+    p->dump(f);
+    f->close_section();
+  }
+  f->close_section();
+}
+
+
+
 void MDBalancer::prep_rebalance(int beat)
 {
   if (g_conf->mds_thrash_exports) {
@@ -982,22 +1168,13 @@ void MDBalancer::hit_dir(utime_t now, CDir *dir, int type, int who, double amoun
     dout(20) << "hit_dir " << type << " pop is " << v << ", frag " << dir->get_frag()
 	     << " size " << dir->get_frag_size() << dendl;
 
-    // split
-    if (g_conf->mds_bal_split_size > 0 &&
-	(dir->should_split() ||
-	 (v > g_conf->mds_bal_split_rd && type == META_POP_IRD) ||
-	 (v > g_conf->mds_bal_split_wr && type == META_POP_IWR)) &&
-	split_queue.count(dir->dirfrag()) == 0) {
-      dout(10) << "hit_dir " << type << " pop is " << v << ", putting in split_queue: " << *dir << dendl;
-      split_queue.insert(dir->dirfrag());
-    }
-
-    // merge?
-    if (dir->get_frag() != frag_t() && dir->should_merge() &&
-	merge_queue.count(dir->dirfrag()) == 0) {
-      dout(10) << "hit_dir " << type << " pop is " << v << ", putting in merge_queue: " << *dir << dendl;
-      merge_queue.insert(dir->dirfrag());
+    // leave the split/merge call to evaluate_fragments()
+    frag_sample_t& sample = frag_samples[dir->dirfrag()];
+    if (sample.stamp == utime_t()) {
+      sample.stamp = now;
+      sample.size = dir->get_frag_size();
     }
+    sample.hit = true;
   }
 
   // replicate?
@@ -1083,6 +1260,40 @@ void MDBalancer::hit_dir(utime_t now, CDir *dir, int type, int who, double amoun
 }
 
 
+/*
+ * A request is about to block on this lock.  Dentry locks and the
+ * directory's own scatterlocks are what serialize updates to a
+ * directory, so charge the wait to the dirfrag(s) involved.
+ */
+void MDBalancer::hit_lock_wait(SimpleLock *lock)
+{
+  if (frag_samples.empty())
+    return;
+
+  list<CDir*> dirs;
+  switch (lock->get_type()) {
+  case CEPH_LOCK_DN:
+    dirs.push_back(static_cast<CDentry*>(lock->get_parent())->get_dir());
+    break;
+  case CEPH_LOCK_IFILE:
+  case CEPH_LOCK_INEST:
+    {
+      CInode *in = static_cast<CInode*>(lock->get_parent());
+      if (in->is_dir())
+	in->get_dirfrags(dirs);
+    }
+    break;
+  default:
+    return;
+  }
+
+  for (list<CDir*>::iterator p = dirs.begin(); p != dirs.end(); ++p) {
+    map<dirfrag_t, frag_sample_t>::iterator q = frag_samples.find((*p)->dirfrag());
+    if (q != frag_samples.end())
+      q->second.lock_waits++;
+  }
+}
+
 /*
  * subtract off an exported chunk.
  *  this excludes *dir itself (encode_export_dir should have take care of that)
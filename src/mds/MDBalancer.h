@@ -32,6 +32,7 @@ class Message;
 class MHeartbeat;
 class CInode;
 class CDir;
+class SimpleLock;
 
 class MDBalancer {
  protected:
@@ -49,6 +50,36 @@ class MDBalancer {
   // todo
   set<dirfrag_t>   split_queue, merge_queue;
 
+  // fragmentation policy: what we saw of each active auth dirfrag
+  // since the last evaluation
+  struct frag_sample_t {
+    utime_t stamp;          // start of the sample
+    uint64_t size;          // frag size at stamp
+    unsigned lock_waits;    // requests that blocked on its locks
+    bool hit;               // touched since the last evaluation
+    frag_sample_t() : size(0), lock_waits(0), hit(false) {}
+  };
+  map<dirfrag_t, frag_sample_t> frag_samples;
+
+  struct frag_decision_t {
+    utime_t stamp;
+    dirfrag_t dirfrag;
+    const char *action;
+    const char *reason;
+    uint64_t size;
+    double rd, wr, growth, waits;
+    mds_rank_t target;
+    void dump(Formatter *f) const;
+  };
+  list<frag_decision_t> frag_history;
+
+  void evaluate_fragments(utime_t now);
+  void note_frag_decision(utime_t now, CDir *dir, const char *action,
+			  const char *reason, double rd, double wr,
+			  double growth, double waits,
+			  mds_rank_t target=MDS_RANK_NONE);
+  mds_rank_t pick_frag_export_target();
+
   // per-epoch scatter/gathered info
   map<mds_rank_t, mds_load_t>  mds_load;
   map<mds_rank_t, float>       mds_meta_load;
@@ -110,6 +141,7 @@ public:
   void hit_inode(utime_t now, class CInode *in, int type, int who=-1);
   void hit_dir(utime_t now, class CDir *dir, int type, int who=-1, double amount=1.0);
   void hit_recursive(utime_t now, class CDir *dir, int type, double amount, double rd_adj);
+  void hit_lock_wait(SimpleLock *lock);
 
 
   void show_imports(bool external=false);
@@ -117,6 +149,8 @@ public:
   void queue_split(CDir *dir);
   void queue_merge(CDir *dir);
 
+  void dump_frag_history(Formatter *f) const;
+
 };
 
 
@@ -6758,6 +6758,53 @@ void MDCache::try_trim_non_auth_subtree(CDir *dir)
   show_subtrees();
 }
 
+void MDCache::note_standby_hot_dirfrag(dirfrag_t df)
+{
+  unsigned max = g_conf->mds_standby_replay_prefetch_dirfrags;
+  if (!max)
+    return;
+
+  map<dirfrag_t, list<dirfrag_t>::iterator>::iterator p =
+    standby_hot_dirfrag_map.find(df);
+  if (p != standby_hot_dirfrag_map.end())
+    standby_hot_dirfrags.erase(p->second);
+  standby_hot_dirfrags.push_front(df);
+  standby_hot_dirfrag_map[df] = standby_hot_dirfrags.begin();
+
+  while (standby_hot_dirfrags.size() > max) {
+    standby_hot_dirfrag_map.erase(standby_hot_dirfrags.back());
+    standby_hot_dirfrags.pop_back();
+  }
+}
+
+/*
+ * After taking over from the mds we were following, load the
+ * dirfrags it was busy with so that the first client requests after
+ * failover do not each wait for a dirfrag fetch.
+ */
+void MDCache::prefetch_standby_hot_dirfrags()
+{
+  dout(10) << "prefetch_standby_hot_dirfrags " << standby_hot_dirfrags.size()
+	   << " candidates" << dendl;
+
+  int fetched = 0;
+  for (list<dirfrag_t>::iterator p = standby_hot_dirfrags.begin();
+       p != standby_hot_dirfrags.end();
+       ++p) {
+    CDir *dir = get_dirfrag(*p);
+    if (!dir || !dir->is_auth() || dir->is_complete() ||
+	dir->state_test(CDir::STATE_FETCHING) || !dir->can_auth_pin())
+      continue;
+    dout(15) << " prefetching " << *dir << dendl;
+    dir->fetch(NULL);
+    ++fetched;
+  }
+  dout(10) << "prefetch_standby_hot_dirfrags fetching " << fetched << " dirfrags" << dendl;
+
+  standby_hot_dirfrags.clear();
+  standby_hot_dirfrag_map.clear();
+}
+
 void MDCache::standby_trim_segment(LogSegment *ls)
 {
   ls->new_dirfrags.clear_list();
@@ -7743,7 +7790,10 @@ int MDCache::path_traverse(MDRequestRef& mdr, Message *req, MDSInternalContextBa
 	// directory isn't complete; reload
         dout(7) << "traverse: incomplete dir contents for " << *cur << ", fetching" << dendl;
         touch_inode(cur);
-        curdir->fetch(_get_waiter(mdr, req, fin), path[depth]);
+	if (snapid == CEPH_NOSNAP && curdir->should_fetch_dentry())
+	  curdir->fetch_dentry(_get_waiter(mdr, req, fin), path[depth]);
+	else
+	  curdir->fetch(_get_waiter(mdr, req, fin), path[depth]);
 	if (mds->logger) mds->logger->inc(l_mds_traverse_dir_fetch);
         return 1;
       }
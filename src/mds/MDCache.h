@@ -609,6 +609,13 @@ public:
   void trim_non_auth();      // trim out trimmable non-auth items
   bool trim_non_auth_subtree(CDir *directory);
   void standby_trim_segment(LogSegment *ls);
+
+  // dirfrags the active mds has been modifying, as seen while tailing
+  // its journal in standby-replay; prefetched when we take over.
+  list<dirfrag_t> standby_hot_dirfrags;  // most recent first
+  map<dirfrag_t, list<dirfrag_t>::iterator> standby_hot_dirfrag_map;
+  void note_standby_hot_dirfrag(dirfrag_t df);
+  void prefetch_standby_hot_dirfrags();
   void try_trim_non_auth_subtree(CDir *dir);
   bool can_trim_non_auth_dirfrag(CDir *dir) {
     return my_ambiguous_imports.count((dir)->dirfrag()) == 0 &&
@@ -74,6 +74,10 @@ void MDLog::create_logger()
   plb.add_u64(l_mdl_wrpos, "wrpos");
   plb.add_u64(l_mdl_rdpos, "rdpos");
   plb.add_u64(l_mdl_jlat, "jlat");
+  plb.add_u64_avg(l_mdl_jbatch, "jbatch",
+      "Journal write size");
+  plb.add_time_avg(l_mdl_jcommit, "jcommit",
+      "Event submit to safe latency");
 
   // logger
   logger = plb.create_perf_counters();
@@ -144,7 +148,7 @@ void MDLog::create(MDSInternalContextBase *c)
   // Instantiate Journaler and start async write to RADOS
   assert(journaler == NULL);
   journaler = new Journaler(ino, mds->mdsmap->get_metadata_pool(), CEPH_FS_ONDISK_MAGIC, mds->objecter,
-			    logger, l_mdl_jlat,
+			    logger, l_mdl_jlat, l_mdl_jbatch,
 			    &mds->timer,
                             &mds->finisher);
   assert(journaler->is_readonly());
@@ -315,6 +319,27 @@ void MDLog::_submit_entry(LogEvent *le, MDSInternalContextBase *c)
   }
 }
 
+/*
+ * Records how long an event waited between submission and being safe
+ * in the journal, then completes the caller's context.
+ */
+class C_MDL_CommitWait : public Context {
+  MDLog *mdlog;
+  utime_t stamp;
+  Context *fin;
+public:
+  C_MDL_CommitWait(MDLog *m, utime_t s, Context *c)
+    : mdlog(m), stamp(s), fin(c) {}
+  void finish(int r) {
+    if (mdlog->logger) {
+      utime_t lat = ceph_clock_now(g_ceph_context);
+      lat -= stamp;
+      mdlog->logger->tinc(l_mdl_jcommit, lat);
+    }
+    fin->complete(r);
+  }
+};
+
 void MDLog::_submit_thread()
 {
   dout(10) << "_submit_thread start" << dendl;
@@ -359,7 +384,8 @@ void MDLog::_submit_thread()
       ls->end = journaler->get_write_pos();
 
       if (data.fin)
-	journaler->wait_for_flush(new C_IO_Wrapper(mds, data.fin));
+	journaler->wait_for_flush(new C_MDL_CommitWait(this, le->get_stamp(),
+						       new C_IO_Wrapper(mds, data.fin)));
       if (data.flush)
 	journaler->flush();
 
@@ -837,7 +863,7 @@ void MDLog::_recovery_thread(MDSInternalContextBase *completion)
     dout(1) << "Erasing journal " << jp.back << dendl;
     C_SaferCond erase_waiter;
     Journaler back(jp.back, mds->mdsmap->get_metadata_pool(), CEPH_FS_ONDISK_MAGIC,
-        mds->objecter, logger, l_mdl_jlat, &mds->timer, &mds->finisher);
+        mds->objecter, logger, l_mdl_jlat, l_mdl_jbatch, &mds->timer, &mds->finisher);
 
     // Read all about this journal (header + extents)
     C_SaferCond recover_wait;
@@ -866,7 +892,7 @@ void MDLog::_recovery_thread(MDSInternalContextBase *completion)
 
   /* Read the header from the front journal */
   Journaler *front_journal = new Journaler(jp.front, mds->mdsmap->get_metadata_pool(),
-      CEPH_FS_ONDISK_MAGIC, mds->objecter, logger, l_mdl_jlat, &mds->timer, &mds->finisher);
+      CEPH_FS_ONDISK_MAGIC, mds->objecter, logger, l_mdl_jlat, l_mdl_jbatch, &mds->timer, &mds->finisher);
   C_SaferCond recover_wait;
   front_journal->recover(&recover_wait);
   dout(4) << "Waiting for journal " << jp.front << " to recover..." << dendl;
@@ -933,7 +959,7 @@ void MDLog::_reformat_journal(JournalPointer const &jp_in, Journaler *old_journa
 
   /* Create the new Journaler file */
   Journaler *new_journal = new Journaler(jp.back, mds->mdsmap->get_metadata_pool(),
-      CEPH_FS_ONDISK_MAGIC, mds->objecter, logger, l_mdl_jlat, &mds->timer, &mds->finisher);
+      CEPH_FS_ONDISK_MAGIC, mds->objecter, logger, l_mdl_jlat, l_mdl_jbatch, &mds->timer, &mds->finisher);
   dout(4) << "Writing new journal header " << jp.back << dendl;
   ceph_file_layout new_layout = old_journal->get_layout();
   new_journal->set_writeable();
@@ -1093,6 +1119,12 @@ void MDLog::_replay_thread()
 {
   dout(10) << "_replay_thread start" << dendl;
 
+  if (g_conf->mds_log_replay_prefetch_periods)
+    journaler->set_prefetch_periods(g_conf->mds_log_replay_prefetch_periods);
+
+  replay_apply_stop = false;
+  replay_apply_thread.create();
+
   // loop
   int r = 0;
   while (1) {
@@ -1118,6 +1150,9 @@ void MDLog::_replay_thread()
           dout(0) << "expire_pos is higher than read_pos, returning EAGAIN" << dendl;
           r = -EAGAIN;
         } else {
+          // segments may be trimmed below; finish replaying what we have
+          _replay_apply_drain();
+
           /* re-read head and check it
            * Given that replay happens in a separate thread and
            * the MDS is going to either shut down or restart when
@@ -1184,7 +1219,10 @@ void MDLog::_replay_thread()
 	event_seq = sle->event_seq;
       else
 	event_seq = pos;
+      // queued events may be looking up segments under mds_lock
+      mds->mds_lock.Lock();
       segments[event_seq] = new LogSegment(event_seq, pos);
+      mds->mds_lock.Unlock();
       logger->set(l_mdl_seg, segments.size());
     } else {
       event_seq++;
@@ -1194,6 +1232,7 @@ void MDLog::_replay_thread()
     if (segments.empty()) {
       dout(10) << "_replay " << pos << "~" << bl.length() << " / " << journaler->get_write_pos() 
 	       << " " << le->get_stamp() << " -- waiting for subtree_map.  (skipping " << *le << ")" << dendl;
+      delete le;
     } else {
       dout(10) << "_replay " << pos << "~" << bl.length() << " / " << journaler->get_write_pos() 
 	       << " " << le->get_stamp() << ": " << *le << dendl;
@@ -1202,15 +1241,22 @@ void MDLog::_replay_thread()
       le->_segment->end = journaler->get_read_pos();
       num_events++;
 
-      mds->mds_lock.Lock();
-      le->replay(mds);
-      mds->mds_lock.Unlock();
+      _replay_queue_event(le);
     }
-    delete le;
 
     logger->set(l_mdl_rdpos, pos);
   }
 
+  _replay_apply_drain();
+  replay_apply_lock.Lock();
+  replay_apply_stop = true;
+  replay_apply_cond.SignalAll();
+  replay_apply_lock.Unlock();
+  replay_apply_thread.join();
+
+  if (g_conf->mds_log_replay_prefetch_periods)
+    journaler->set_prefetch_periods(0);
+
   // done!
   if (r == 0) {
     assert(journaler->get_read_pos() == journaler->get_write_pos());
@@ -1228,6 +1274,71 @@ void MDLog::_replay_thread()
   dout(10) << "_replay_thread finish" << dendl;
 }
 
+/*
+ * Queue a decoded event for the apply thread, waiting if it has
+ * fallen mds_log_replay_queue_max events behind.
+ */
+void MDLog::_replay_queue_event(LogEvent *le)
+{
+  uint32_t max = g_conf->mds_log_replay_queue_max;
+  if (max < 1)
+    max = 1;
+  Mutex::Locker l(replay_apply_lock);
+  while (replay_apply_queue.size() >= max)
+    replay_apply_cond.Wait(replay_apply_lock);
+  replay_apply_queue.push_back(le);
+  replay_apply_cond.SignalAll();
+}
+
+/*
+ * Wait until every queued event has been replayed.
+ */
+void MDLog::_replay_apply_drain()
+{
+  Mutex::Locker l(replay_apply_lock);
+  while (!replay_apply_queue.empty() || replay_applying)
+    replay_apply_cond.Wait(replay_apply_lock);
+}
+
+void MDLog::_replay_apply_thread()
+{
+  dout(10) << "_replay_apply_thread start" << dendl;
+
+  replay_apply_lock.Lock();
+  while (true) {
+    if (replay_apply_queue.empty()) {
+      if (replay_apply_stop)
+	break;
+      replay_apply_cond.Wait(replay_apply_lock);
+      continue;
+    }
+
+    // replay everything decoded so far under one mds_lock hold
+    list<LogEvent*> batch;
+    batch.swap(replay_apply_queue);
+    replay_applying = true;
+    replay_apply_cond.SignalAll();
+    replay_apply_lock.Unlock();
+
+    mds->mds_lock.Lock();
+    for (list<LogEvent*>::iterator p = batch.begin(); p != batch.end(); ++p)
+      (*p)->replay(mds);
+    mds->mds_lock.Unlock();
+
+    while (!batch.empty()) {
+      delete batch.front();
+      batch.pop_front();
+    }
+
+    replay_apply_lock.Lock();
+    replay_applying = false;
+    replay_apply_cond.SignalAll();
+  }
+  replay_apply_lock.Unlock();
+
+  dout(10) << "_replay_apply_thread finish" << dendl;
+}
+
 void MDLog::standby_trim_segments()
 {
   dout(10) << "standby_trim_segments" << dendl;
@@ -34,6 +34,8 @@ enum {
   l_mdl_wrpos,
   l_mdl_rdpos,
   l_mdl_jlat,
+  l_mdl_jbatch,
+  l_mdl_jcommit,
   l_mdl_last,
 };
 
@@ -78,6 +80,7 @@ protected:
   Journaler *journaler;
 
   PerfCounters *logger;
+  friend class C_MDL_CommitWait;
 
 
   // -- replay --
@@ -100,6 +103,28 @@ protected:
   void _replay();         // old way
   void _replay_thread();  // new way
 
+  // The replay thread reads and decodes events and hands them to the
+  // apply thread, which replays them in order under mds_lock, so that
+  // decoding and journal reads overlap with cache updates.
+  class ReplayApplyThread : public Thread {
+    MDLog *log;
+  public:
+    ReplayApplyThread(MDLog *l) : log(l) {}
+    void* entry() {
+      log->_replay_apply_thread();
+      return 0;
+    }
+  } replay_apply_thread;
+  Mutex replay_apply_lock;
+  Cond replay_apply_cond;
+  list<LogEvent*> replay_apply_queue;
+  bool replay_applying;
+  bool replay_apply_stop;
+
+  void _replay_apply_thread();
+  void _replay_queue_event(LogEvent *le);
+  void _replay_apply_drain();
+
   // Journal recovery/rewrite logic
   class RecoveryThread : public Thread {
     MDLog *log;
@@ -188,6 +213,10 @@ public:
 		  logger(0),
 		  replay_thread(this),
 		  already_replayed(false),
+		  replay_apply_thread(this),
+		  replay_apply_lock("MDLog::replay_apply_lock"),
+		  replay_applying(false),
+		  replay_apply_stop(false),
 		  recovery_thread(this),
 		  event_seq(0), expiring_events(0), expired_events(0),
 		  submit_mutex("MDLog::submit_mutex"),
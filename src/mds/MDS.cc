@@ -103,6 +103,7 @@ MDS::MDS(const std::string &n, Messenger *m, MonClient *mc) :
   standby_for_rank(MDSMap::MDS_NO_STANDBY_PREF),
   standby_type(MDSMap::STATE_NULL),
   standby_replaying(false),
+  standby_replay_pass_start(0),
   messenger(m),
   monc(mc),
   log_client(m->cct, messenger, &mc->monmap, LogClient::NO_FLAGS),
@@ -112,6 +113,10 @@ MDS::MDS(const std::string &n, Messenger *m, MonClient *mc) :
   osd_epoch_barrier(0),
   sessionmap(this),
   progress_thread(this),
+  client_fast_dispatch(m->cct->_conf->mds_client_fast_dispatch),
+  client_queue_lock("MDS::client_queue_lock"),
+  client_queue_stopping(false),
+  client_dispatch_thread(this),
   asok_hook(NULL)
 {
 
@@ -333,6 +338,10 @@ bool MDS::asok_command(string command, cmdmap_t& cmdmap, string format,
       command_flush_journal(f);
     } else if (command == "get subtrees") {
       command_get_subtrees(f);
+    } else if (command == "dirfrag history") {
+      mds_lock.Lock();
+      balancer->dump_frag_history(f);
+      mds_lock.Unlock();
     } else if (command == "export dir") {
       string path;
       if(!cmd_getval(g_ceph_context, cmdmap, "path", path)) {
@@ -632,6 +641,11 @@ void MDS::set_up_admin_socket()
 				     asok_hook,
 				     "Return the subtree map");
   assert(r == 0);
+  r = admin_socket->register_command("dirfrag history",
+				     "dirfrag history",
+				     asok_hook,
+				     "Show recent automatic split/merge/export decisions");
+  assert(r == 0);
 }
 
 void MDS::clean_up_admin_socket()
@@ -647,6 +661,7 @@ void MDS::clean_up_admin_socket()
   admin_socket->unregister_command("session ls");
   admin_socket->unregister_command("flush journal");
   admin_socket->unregister_command("force_readonly");
+  admin_socket->unregister_command("dirfrag history");
   delete asok_hook;
   asok_hook = NULL;
 }
@@ -713,8 +728,12 @@ void MDS::create_logger()
     mds_plb.add_u64_counter(l_mds_forward, "forward");
     
     mds_plb.add_u64_counter(l_mds_dir_fetch, "dir_fetch");
+    mds_plb.add_u64_counter(l_mds_dir_fetch_dentry, "dir_fetch_dentry");
     mds_plb.add_u64_counter(l_mds_dir_commit, "dir_commit");
     mds_plb.add_u64_counter(l_mds_dir_split, "dir_split");
+    mds_plb.add_u64_counter(l_mds_frag_split, "frag_split");
+    mds_plb.add_u64_counter(l_mds_frag_merge, "frag_merge");
+    mds_plb.add_u64_counter(l_mds_frag_export, "frag_export");
 
     mds_plb.add_u64(l_mds_inode_max, "inode_max");
     mds_plb.add_u64(l_mds_inodes, "inodes", "Inodes", "inos");
@@ -725,6 +744,11 @@ void MDS::create_logger()
     mds_plb.add_u64(l_mds_inodes_expired, "inodes_expired");
     mds_plb.add_u64(l_mds_inodes_with_caps, "inodes_with_caps");
     mds_plb.add_u64(l_mds_caps, "caps", "Capabilities", "caps");
+    mds_plb.add_u64_counter(l_mds_cap_release, "cap_release",
+        "Capabilities released by clients", "crel");
+    mds_plb.add_u64_avg(l_mds_cap_release_batch, "cap_release_batch");
+    mds_plb.add_u64_counter(l_mds_cap_revoke, "cap_revoke",
+        "Capability revocations sent", "crev");
     mds_plb.add_u64(l_mds_subtrees, "subtrees");
     
     mds_plb.add_u64_counter(l_mds_traverse, "traverse"); 
@@ -737,6 +761,8 @@ void MDS::create_logger()
     
     mds_plb.add_u64(l_mds_load_cent, "load_cent");
     mds_plb.add_u64(l_mds_dispatch_queue_len, "q");
+    mds_plb.add_u64(l_mds_client_queue_len, "client_q");
+    mds_plb.add_u64_avg(l_mds_client_dispatch_batch, "client_dispatch_batch");
     
     mds_plb.add_u64_counter(l_mds_exported, "exported");
     mds_plb.add_u64_counter(l_mds_exported_inodes, "exported_inodes");
@@ -1049,6 +1075,8 @@ int MDS::init(MDSMap::DaemonState wanted_state)
 
   // Start handler for finished_queue
   progress_thread.create();
+  if (client_fast_dispatch)
+    client_dispatch_thread.create();
 
   create_logger();
   set_up_admin_socket();
@@ -1106,6 +1134,10 @@ void MDS::tick()
     
     logger->set(l_mds_load_cent, 100 * load.mds_load());
     logger->set(l_mds_dispatch_queue_len, messenger->get_dispatch_queue_len());
+    if (client_fast_dispatch) {
+      Mutex::Locker l(client_queue_lock);
+      logger->set(l_mds_client_queue_len, client_queue.size());
+    }
     logger->set(l_mds_subtrees, mdcache->num_subtrees());
 
     mdcache->log_stat();
@@ -2054,6 +2086,7 @@ inline void MDS::standby_replay_restart()
   dout(1) << "standby_replay_restart"
 	  << (standby_replaying ? " (as standby)":" (final takeover pass)")
 	  << dendl;
+  standby_replay_pass_start = mdlog->get_journaler()->get_read_pos();
   if (standby_replaying) {
     /* Go around for another pass of replaying in standby */
     mdlog->get_journaler()->reread_head_and_probe(
@@ -2103,9 +2136,14 @@ void MDS::replay_done()
   if (is_standby_replay()) {
     // The replay was done in standby state, and we are still in that state
     assert(standby_replaying);
-    dout(10) << "setting replay timer" << dendl;
-    timer.add_event_after(g_conf->mds_replay_interval,
-                          new C_MDS_StandbyReplayRestart(this));
+    // keep up with a busy active: if this pass found new events, look
+    // again soon rather than waiting out the full interval.
+    double interval = g_conf->mds_replay_interval;
+    if (mdlog->get_journaler()->get_read_pos() > standby_replay_pass_start &&
+	g_conf->mds_standby_replay_tail_interval < interval)
+      interval = g_conf->mds_standby_replay_tail_interval;
+    dout(10) << "setting replay timer for " << interval << "s" << dendl;
+    timer.add_event_after(interval, new C_MDS_StandbyReplayRestart(this));
     return;
   } else if (standby_replaying) {
     // The replay was done in standby state, we have now _left_ that state
@@ -2246,6 +2284,7 @@ void MDS::active_start()
 
   mdcache->clean_open_file_lists();
   mdcache->export_remaining_imported_caps();
+  mdcache->prefetch_standby_hot_dirfrags();
   finish_contexts(g_ceph_context, waiting_for_replay);  // kick waiters
   finish_contexts(g_ceph_context, waiting_for_active);  // kick waiters
 }
@@ -2368,6 +2407,7 @@ void MDS::suicide()
   op_tracker.on_shutdown();
 
   progress_thread.shutdown();
+  client_dispatch_shutdown();
 
   // shut down messenger
   messenger->shutdown();
@@ -2461,6 +2501,152 @@ bool MDS::ms_dispatch(Message *m)
   return ret;
 }
 
+bool MDS::ms_can_fast_dispatch(Message *m) const
+{
+  if (!client_fast_dispatch)
+    return false;
+  // All client traffic goes down the same path so that per-session
+  // ordering (open, reconnect, requests, caps) is preserved.
+  switch (m->get_type()) {
+  case CEPH_MSG_CLIENT_SESSION:
+  case CEPH_MSG_CLIENT_RECONNECT:
+  case CEPH_MSG_CLIENT_REQUEST:
+  case CEPH_MSG_CLIENT_CAPS:
+  case CEPH_MSG_CLIENT_CAPRELEASE:
+  case CEPH_MSG_CLIENT_LEASE:
+    return true;
+  default:
+    return false;
+  }
+}
+
+void MDS::ms_fast_dispatch(Message *m)
+{
+  Mutex::Locker l(client_queue_lock);
+  if (client_queue_stopping) {
+    m->put();
+    return;
+  }
+  client_queue.push_back(client_item_t(m));
+  if (client_queue.size() == 1)
+    client_queue_cond.Signal();
+}
+
+void MDS::ms_handle_fast_accept(Connection *con)
+{
+  Mutex::Locker l(client_queue_lock);
+  if (client_queue_stopping)
+    return;
+  client_queue.push_back(client_item_t(client_item_t::ACCEPT, con));
+  if (client_queue.size() == 1)
+    client_queue_cond.Signal();
+}
+
+void MDS::_client_dispatch_entry()
+{
+  client_queue_lock.Lock();
+  while (!client_queue_stopping) {
+    if (client_queue.empty()) {
+      client_queue_cond.Wait(client_queue_lock);
+      continue;
+    }
+
+    list<client_item_t> batch;
+    unsigned max = g_conf->mds_client_dispatch_batch;
+    if (max == 0 || client_queue.size() <= max) {
+      batch.swap(client_queue);
+    } else {
+      list<client_item_t>::iterator p = client_queue.begin();
+      for (unsigned i = 0; i < max; ++i)
+	++p;
+      batch.splice(batch.end(), client_queue, client_queue.begin(), p);
+    }
+    client_queue_lock.Unlock();
+
+    mds_lock.Lock();
+    _dispatch_client_batch(batch);
+    mds_lock.Unlock();
+
+    client_queue_lock.Lock();
+  }
+  client_queue_lock.Unlock();
+}
+
+/*
+ * Handle a batch of client messages under a single mds_lock hold.
+ * The per-dispatch housekeeping in _dispatch (finished contexts,
+ * clientreplay/shutdown checks, stats) only runs after the last one.
+ */
+void MDS::_dispatch_client_batch(list<client_item_t>& batch)
+{
+  assert(mds_lock.is_locked_by_me());
+
+  heartbeat_reset();
+  if (logger)
+    logger->inc(l_mds_client_dispatch_batch, batch.size());
+
+  while (!batch.empty()) {
+    int op = batch.front().op;
+    Message *m = batch.front().m;
+    ConnectionRef con = batch.front().con;
+    batch.pop_front();
+
+    if (op == client_item_t::ACCEPT) {
+      _handle_accept(con.get());
+      continue;
+    }
+    if (op == client_item_t::RESET) {
+      _handle_reset(con.get());
+      continue;
+    }
+
+    if (want_state == CEPH_MDS_STATE_DNE) {
+      dout(10) << " stopping, discarding " << *m << dendl;
+      m->put();
+      continue;
+    }
+
+    bool last = batch.empty();
+    inc_dispatch_depth();
+    if (!last)
+      inc_dispatch_depth();
+    _dispatch(m);
+    if (!last)
+      dec_dispatch_depth();
+    dec_dispatch_depth();
+  }
+}
+
+void MDS::client_dispatch_shutdown()
+{
+  assert(mds_lock.is_locked_by_me());
+
+  client_queue_lock.Lock();
+  client_queue_stopping = true;
+  client_queue_cond.Signal();
+  list<client_item_t> dropped;
+  dropped.swap(client_queue);
+  client_queue_lock.Unlock();
+
+  if (client_dispatch_thread.is_started()) {
+    if (client_dispatch_thread.am_self()) {
+      // suicide() from a client message; the thread exits once we
+      // unwind back to _client_dispatch_entry.
+      client_dispatch_thread.detach();
+    } else {
+      mds_lock.Unlock();
+      client_dispatch_thread.join();
+      mds_lock.Lock();
+    }
+  }
+
+  while (!dropped.empty()) {
+    if (dropped.front().m)
+      dropped.front().m->put();
+    dropped.pop_front();
+  }
+}
+
 bool MDS::ms_get_authorizer(int dest_type, AuthAuthorizer **authorizer, bool force_new)
 {
   dout(10) << "MDS::ms_get_authorizer type=" << ceph_entity_type_name(dest_type) << dendl;
@@ -2847,10 +3033,28 @@ bool MDS::ms_handle_reset(Connection *con)
   if (con->get_peer_type() != CEPH_ENTITY_TYPE_CLIENT)
     return false;
 
+  if (client_fast_dispatch) {
+    // keep the reset behind messages already queued for this connection
+    Mutex::Locker l(client_queue_lock);
+    if (!client_queue_stopping) {
+      client_queue.push_back(client_item_t(client_item_t::RESET, con));
+      if (client_queue.size() == 1)
+	client_queue_cond.Signal();
+    }
+    return false;
+  }
+
   Mutex::Locker l(mds_lock);
+  _handle_reset(con);
+  return false;
+}
+
+void MDS::_handle_reset(Connection *con)
+{
+  assert(mds_lock.is_locked_by_me());
   dout(5) << "ms_handle_reset on " << con->get_peer_addr() << dendl;
   if (want_state == CEPH_MDS_STATE_DNE)
-    return false;
+    return;
 
   Session *session = static_cast<Session *>(con->get_priv());
   if (session) {
@@ -2863,7 +3067,6 @@ bool MDS::ms_handle_reset(Connection *con)
   } else {
     con->mark_down();
   }
-  return false;
 }
 
 
@@ -2978,7 +3181,17 @@ bool MDS::ms_verify_authorizer(Connection *con, int peer_type,
 
 void MDS::ms_handle_accept(Connection *con)
 {
+  // with client fast dispatch the accept is queued on client_queue by
+  // ms_handle_fast_accept, in order with the connection's messages
+  if (client_fast_dispatch)
+    return;
   Mutex::Locker l(mds_lock);
+  _handle_accept(con);
+}
+
+void MDS::_handle_accept(Connection *con)
+{
+  assert(mds_lock.is_locked_by_me());
   Session *s = static_cast<Session *>(con->get_priv());
   dout(10) << "ms_handle_accept " << con->get_peer_addr() << " con " << con << " session " << s << dendl;
   if (s) {
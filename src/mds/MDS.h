@@ -48,8 +48,12 @@ enum {
   l_mds_reply_latency,
   l_mds_forward,
   l_mds_dir_fetch,
+  l_mds_dir_fetch_dentry,
   l_mds_dir_commit,
   l_mds_dir_split,
+  l_mds_frag_split,
+  l_mds_frag_merge,
+  l_mds_frag_export,
   l_mds_inode_max,
   l_mds_inodes,
   l_mds_inodes_top,
@@ -59,6 +63,9 @@ enum {
   l_mds_inodes_expired,
   l_mds_inodes_with_caps,
   l_mds_caps,
+  l_mds_cap_release,
+  l_mds_cap_release_batch,
+  l_mds_cap_revoke,
   l_mds_subtrees,
   l_mds_traverse,
   l_mds_traverse_hit,
@@ -69,6 +76,8 @@ enum {
   l_mds_traverse_lock,
   l_mds_load_cent,
   l_mds_dispatch_queue_len,
+  l_mds_client_queue_len,
+  l_mds_client_dispatch_batch,
   l_mds_exported,
   l_mds_exported_inodes,
   l_mds_imported,
@@ -162,6 +171,7 @@ class MDS : public Dispatcher, public md_config_obs_t {
   MDSMap::DaemonState standby_type;  // one of STANDBY_REPLAY, ONESHOT_REPLAY
   string standby_for_name;
   bool standby_replaying;  // true if current replay pass is in standby-replay mode
+  uint64_t standby_replay_pass_start;  // journal read_pos when the current pass began
 
   Messenger    *messenger;
   MonClient    *monc;
@@ -316,11 +326,17 @@ public:
  private:
   int dispatch_depth;
   bool ms_dispatch(Message *m);
+  bool ms_can_fast_dispatch_any() const { return client_fast_dispatch; }
+  bool ms_can_fast_dispatch(Message *m) const;
+  void ms_fast_dispatch(Message *m);
   bool ms_get_authorizer(int dest_type, AuthAuthorizer **authorizer, bool force_new);
   bool ms_verify_authorizer(Connection *con, int peer_type,
 			       int protocol, bufferlist& authorizer_data, bufferlist& authorizer_reply,
 			       bool& isvalid, CryptoKey& session_key);
   void ms_handle_accept(Connection *con);
+  void ms_handle_fast_accept(Connection *con);
+  void _handle_accept(Connection *con);
+  void _handle_reset(Connection *con);
   void ms_handle_connect(Connection *con);
   bool ms_handle_reset(Connection *con);
   void ms_handle_remote_reset(Connection *con);
@@ -338,6 +354,47 @@ private:
   } progress_thread;
   void _progress_thread();
 
+  /*
+   * Client messages may be fast-dispatched into client_queue and
+   * drained by client_dispatch_thread, which handles up to
+   * mds_client_dispatch_batch of them per mds_lock acquisition.  This
+   * keeps the messenger threads from blocking on mds_lock and keeps
+   * mon/osd/mds traffic from queueing behind client requests.
+   * Accepts and resets of client connections go through the same
+   * queue so that they are handled in order with the connection's
+   * messages.
+   */
+  struct client_item_t {
+    enum {
+      MESSAGE,
+      ACCEPT,
+      RESET,
+    };
+    int op;
+    Message *m;         ///< for MESSAGE
+    ConnectionRef con;  ///< for ACCEPT and RESET
+    explicit client_item_t(Message *m_) : op(MESSAGE), m(m_) {}
+    client_item_t(int o, Connection *c) : op(o), m(NULL), con(c) {}
+  };
+  const bool client_fast_dispatch;
+  Mutex client_queue_lock;
+  Cond client_queue_cond;
+  list<client_item_t> client_queue;
+  bool client_queue_stopping;
+
+  class ClientDispatchThread : public Thread {
+    MDS *mds;
+  public:
+    ClientDispatchThread(MDS *mds_) : mds(mds_) {}
+    void *entry() {
+      mds->_client_dispatch_entry();
+      return NULL;
+    }
+  } client_dispatch_thread;
+  void _client_dispatch_entry();
+  void _dispatch_client_batch(list<client_item_t>& batch);
+  void client_dispatch_shutdown();
+
  public:
   MDS(const std::string &n, Messenger *m, MonClient *mc);
   ~MDS();
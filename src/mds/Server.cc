@@ -383,12 +383,14 @@ void Server::_session_logged(Session *session, uint64_t state_seq, bool open, ve
   } else if (session->is_closing() ||
 	     session->is_killing()) {
     // kill any lingering capabilities, leases, requests
+    set<CInode*> eval_set, issue_set;
     while (!session->caps.empty()) {
       Capability *cap = session->caps.front();
       CInode *in = cap->get_inode();
       dout(20) << " killing capability " << ccap_string(cap->issued()) << " on " << *in << dendl;
-      mds->locker->remove_client_cap(in, session->info.inst.name.num());
+      mds->locker->remove_client_cap(in, session->info.inst.name.num(), &eval_set);
     }
+    mds->locker->finish_cap_batch(eval_set, issue_set);
     while (!session->leases.empty()) {
       ClientLease *r = session->leases.front();
       CDentry *dn = static_cast<CDentry*>(r->parent);
@@ -2115,7 +2117,10 @@ CDentry* Server::prepare_null_dentry(MDRequestRef& mdr, CDir *dir, const string&
   // make sure dir is complete
   if (!dir->is_complete() && (!dir->has_bloom() || dir->is_in_bloom(dname))) {
     dout(7) << " incomplete dir contents for " << *dir << ", fetching" << dendl;
-    dir->fetch(new C_MDS_RetryRequest(mdcache, mdr));
+    if (dir->should_fetch_dentry())
+      dir->fetch_dentry(new C_MDS_RetryRequest(mdcache, mdr), dname);
+    else
+      dir->fetch(new C_MDS_RetryRequest(mdcache, mdr));
     return 0;
   }
   
@@ -2474,7 +2479,10 @@ CDentry* Server::rdlock_path_xlock_dentry(MDRequestRef& mdr, int n,
     if (!dn && !dir->is_complete() &&
         (!dir->has_bloom() || dir->is_in_bloom(dname))) {
       dout(7) << " incomplete dir contents for " << *dir << ", fetching" << dendl;
-      dir->fetch(new C_MDS_RetryRequest(mdcache, mdr));
+      if (dir->should_fetch_dentry())
+	dir->fetch_dentry(new C_MDS_RetryRequest(mdcache, mdr), dname);
+      else
+	dir->fetch(new C_MDS_RetryRequest(mdcache, mdr));
       return 0;
     }
 
@@ -1184,6 +1184,9 @@ void EMetaBlob::replay(MDS *mds, LogSegment *logseg, MDSlaveUpdate *slaveup)
     dir->set_version( lump.fnode.version );
     dir->fnode = lump.fnode;
 
+    if (mds->is_standby_replay())
+      mds->mdcache->note_standby_hot_dirfrag(dir->dirfrag());
+
     if (lump.is_importing()) {
       dir->state_set(CDir::STATE_AUTH);
       dir->state_clear(CDir::STATE_COMPLETE);
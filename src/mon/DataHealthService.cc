@@ -144,6 +144,7 @@ int DataHealthService::update_store_stats(DataStats &ours)
   ours.store_stats.bytes_log = extra["log"];
   ours.store_stats.bytes_misc = extra["misc"];
   ours.last_update = ceph_clock_now(g_ceph_context);
+  mon->logger->set(l_mon_store_size, store_size);
 
   return 0;
 }
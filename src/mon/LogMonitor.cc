@@ -368,7 +368,13 @@ bool LogMonitor::should_propose(double& delay)
     return true;
 
   // otherwise fall back to generic policy
-  return PaxosService::should_propose(delay);
+  bool r = PaxosService::should_propose(delay);
+
+  // but give log floods their own, slower cadence
+  if (g_conf->mon_log_propose_interval > 0 &&
+      delay < g_conf->mon_log_propose_interval)
+    delay = g_conf->mon_log_propose_interval;
+  return r;
 }
 
 
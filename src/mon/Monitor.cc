@@ -172,6 +172,7 @@ Monitor::Monitor(CephContext* cct_, string nm, MonitorDBStore *s,
   sync_provider_count(0),
   sync_cookie(0),
   sync_full(false),
+  sync_resuming(false),
   sync_start_version(0),
   sync_timeout_event(NULL),
   sync_last_committed_floor(0),
@@ -545,6 +546,9 @@ int Monitor::preinit()
     pcb.add_u64_counter(l_mon_election_call, "election_call", "Elections started");
     pcb.add_u64_counter(l_mon_election_win, "election_win", "Elections won");
     pcb.add_u64_counter(l_mon_election_lose, "election_lose", "Elections lost");
+    pcb.add_u64(l_mon_store_size, "store_size", "Estimated store size", "ssiz");
+    pcb.add_u64_counter(l_mon_trim_keys, "trim_keys", "Versions erased by trimming");
+    pcb.add_u64_counter(l_mon_trim_compact, "trim_compact", "Compactions queued after trimming");
     logger = pcb.create_perf_counters();
     cct->get_perfcounters_collection()->add(logger);
   }
@@ -642,6 +646,12 @@ int Monitor::preinit()
     if (clear_store) {
       set<string> sync_prefixes = get_sync_targets_names();
       store->clear(sync_prefixes);
+
+      // we only resume syncs within a process lifetime
+      MonitorDBStore::TransactionRef t(new MonitorDBStore::Transaction);
+      t->erase("mon_sync", "resume_key");
+      t->erase("mon_sync", "resume_version");
+      store->apply_transaction(t);
     }
   }
 
@@ -1095,6 +1105,7 @@ void Monitor::sync_reset_requester()
   sync_provider = entity_inst_t();
   sync_cookie = 0;
   sync_full = false;
+  sync_resuming = false;
   sync_start_version = 0;
 }
 
@@ -1116,8 +1127,25 @@ void Monitor::sync_start(entity_inst_t &other, bool full)
   sync_reset_provider();
 
   sync_full = full;
-
-  if (sync_full) {
+  sync_resuming = false;
+
+  pair<string,string> resume_key;
+  version_t resume_version = 0;
+  if (sync_full && g_conf->mon_sync_resume &&
+      store->exists("mon_sync", "in_sync") &&
+      store->exists("mon_sync", "resume_key")) {
+    // an earlier attempt got partway through; keep what we have and
+    // ask to continue after the last key we applied
+    bufferlist bl;
+    store->get("mon_sync", "resume_key", bl);
+    bufferlist::iterator p = bl.begin();
+    ::decode(resume_key.first, p);
+    ::decode(resume_key.second, p);
+    resume_version = store->get("mon_sync", "resume_version");
+    sync_resuming = true;
+    dout(10) << __func__ << " resuming after " << resume_key.first << ","
+	     << resume_key.second << " from version " << resume_version << dendl;
+  } else if (sync_full) {
     // stash key state, and mark that we are syncing
     MonitorDBStore::TransactionRef t(new MonitorDBStore::Transaction);
     sync_stash_critical_state(t);
@@ -1127,6 +1155,8 @@ void Monitor::sync_start(entity_inst_t &other, bool full)
     dout(10) << __func__ << " marking sync in progress, storing sync_last_committed_floor "
 	     << sync_last_committed_floor << dendl;
     t->put("mon_sync", "last_committed_floor", sync_last_committed_floor);
+    t->erase("mon_sync", "resume_key");
+    t->erase("mon_sync", "resume_version");
 
     store->apply_transaction(t);
 
@@ -1154,6 +1184,10 @@ void Monitor::sync_start(entity_inst_t &other, bool full)
   MMonSync *m = new MMonSync(sync_full ? MMonSync::OP_GET_COOKIE_FULL : MMonSync::OP_GET_COOKIE_RECENT);
   if (!sync_full)
     m->last_committed = paxos->get_version();
+  if (sync_resuming) {
+    m->last_key = resume_key;
+    m->last_committed = resume_version;
+  }
   messenger->send_message(m, sync_provider);
 }
 
@@ -1203,6 +1237,8 @@ void Monitor::sync_finish(version_t last_committed)
   t->erase("mon_sync", "in_sync");
   t->erase("mon_sync", "force_sync");
   t->erase("mon_sync", "last_committed_floor");
+  t->erase("mon_sync", "resume_key");
+  t->erase("mon_sync", "resume_version");
   store->apply_transaction(t);
 
   assert(g_conf->mon_sync_requester_kill_at != 9);
@@ -1295,7 +1331,18 @@ void Monitor::handle_sync_get_cookie(MMonSync *m)
   if (m->op == MMonSync::OP_GET_COOKIE_FULL) {
     // full scan
     sync_targets = get_sync_targets_names();
-    sp.last_committed = paxos->get_version();
+    if (!m->last_key.first.empty() && m->last_committed &&
+	m->last_committed <= paxos->get_version()) {
+      // continue an interrupted sync: they keep the keys they have, we
+      // send the rest of our snapshot plus every paxos version since
+      // their original start so they can replay over the seam.
+      sp.last_key = m->last_key;
+      sp.last_committed = m->last_committed;
+      dout(10) << __func__ << " resuming after " << sp.last_key.first << ","
+	       << sp.last_key.second << dendl;
+    } else {
+      sp.last_committed = paxos->get_version();
+    }
     sp.synchronizer = store->get_synchronizer(sp.last_key, sync_targets);
     sp.full = true;
     dout(10) << __func__ << " will sync prefixes " << sync_targets << dendl;
@@ -1307,6 +1354,7 @@ void Monitor::handle_sync_get_cookie(MMonSync *m)
 
   MMonSync *reply = new MMonSync(MMonSync::OP_COOKIE, sp.cookie);
   reply->last_committed = sp.last_committed;
+  reply->last_key = sp.last_key;  // non-empty iff we are resuming
   m->get_connection()->send_message(reply);
 }
 
@@ -1391,8 +1439,27 @@ void Monitor::handle_sync_cookie(MMonSync *m)
   sync_cookie = m->cookie;
   sync_start_version = m->last_committed;
 
+  if (sync_resuming && m->last_key.first.empty()) {
+    // provider can't (or won't) continue where we left off; start over
+    dout(10) << __func__ << " provider is not resuming, clearing store" << dendl;
+    sync_resuming = false;
+    MonitorDBStore::TransactionRef t(new MonitorDBStore::Transaction);
+    t->erase("mon_sync", "resume_key");
+    t->erase("mon_sync", "resume_version");
+    store->apply_transaction(t);
+    set<string> targets = get_sync_targets_names();
+    store->clear(targets);
+    paxos->init();
+  }
+
   sync_reset_timeout();
-  sync_get_next_chunk();
+
+  // keep a few chunk requests in flight.  the provider answers them in
+  // order on this connection, and answers any extras after the last
+  // chunk with no_cookie, which we ignore once the cookie is gone.
+  int inflight = MAX(1, g_conf->mon_sync_max_inflight_chunks);
+  for (int i = 0; i < inflight; ++i)
+    sync_get_next_chunk();
 
   assert(g_conf->mon_sync_requester_kill_at != 3);
 }
@@ -1429,6 +1496,15 @@ void Monitor::handle_sync_chunk(MMonSync *m)
   MonitorDBStore::TransactionRef tx(new MonitorDBStore::Transaction);
   tx->append_from_encoded(m->chunk_bl);
 
+  if (sync_full && !m->last_key.first.empty()) {
+    // remember how far we got, atomically with the keys themselves
+    bufferlist bl;
+    ::encode(m->last_key.first, bl);
+    ::encode(m->last_key.second, bl);
+    tx->put("mon_sync", "resume_key", bl);
+    tx->put("mon_sync", "resume_version", sync_start_version);
+  }
+
   dout(30) << __func__ << " tx dump:\n";
   JSONFormatter f(true);
   tx->dump(&f);
@@ -1467,6 +1543,18 @@ void Monitor::handle_sync_chunk(MMonSync *m)
 void Monitor::handle_sync_no_cookie(MMonSync *m)
 {
   dout(10) << __func__ << dendl;
+  if (m->cookie && m->cookie != sync_cookie) {
+    // reply to a pipelined request from a sync that already finished
+    dout(10) << __func__ << " stale cookie " << m->cookie << ", ignoring" << dendl;
+    return;
+  }
+  if (sync_resuming) {
+    // the provider could not continue our sync; don't try again
+    MonitorDBStore::TransactionRef t(new MonitorDBStore::Transaction);
+    t->erase("mon_sync", "resume_key");
+    t->erase("mon_sync", "resume_version");
+    store->apply_transaction(t);
+  }
   bootstrap();
 }
 
@@ -2244,11 +2332,34 @@ health_status_t Monitor::get_health(list<string>& status,
   if (f)
     f->open_object_section("health");
 
-  for (vector<PaxosService*>::iterator p = paxos_service.begin();
-       p != paxos_service.end();
-       ++p) {
-    PaxosService *s = *p;
-    s->get_health(summary, detailbl ? &detail : NULL);
+  utime_t now = ceph_clock_now(g_ceph_context);
+  service_health_cache_t& hc = service_health_cache;
+  if (g_conf->mon_health_cache_ttl > 0 &&
+      hc.stamp != utime_t() &&
+      hc.version == paxos->get_version() &&
+      hc.election_epoch == get_epoch() &&
+      (hc.have_detail || !detailbl) &&
+      (double)(now - hc.stamp) < g_conf->mon_health_cache_ttl) {
+    dout(20) << __func__ << " using cached service health from v"
+	     << hc.version << dendl;
+    summary = hc.summary;
+    if (detailbl)
+      detail = hc.detail;
+  } else {
+    for (vector<PaxosService*>::iterator p = paxos_service.begin();
+	 p != paxos_service.end();
+	 ++p) {
+      PaxosService *s = *p;
+      s->get_health(summary, detailbl ? &detail : NULL);
+    }
+    if (g_conf->mon_health_cache_ttl > 0) {
+      hc.version = paxos->get_version();
+      hc.election_epoch = get_epoch();
+      hc.stamp = now;
+      hc.have_detail = (detailbl != NULL);
+      hc.summary = summary;
+      hc.detail = detail;
+    }
   }
 
   health_monitor->get_health(f, summary, (detailbl ? &detail : NULL));
@@ -4342,6 +4453,8 @@ void Monitor::tick()
     (*p)->tick();
     (*p)->maybe_trim();
   }
+
+  log_client.flush_repeats();
   
   // trim sessions
   utime_t now = ceph_clock_now(g_ceph_context);
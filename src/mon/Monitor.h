@@ -97,6 +97,9 @@ enum {
   l_mon_election_call,
   l_mon_election_win,
   l_mon_election_lose,
+  l_mon_store_size,
+  l_mon_trim_keys,
+  l_mon_trim_compact,
   l_mon_last,
 };
 
@@ -282,6 +285,7 @@ private:
   entity_inst_t sync_provider;   ///< who we are syncing from
   uint64_t sync_cookie;          ///< 0 if we are starting, non-zero otherwise
   bool sync_full;                ///< true if we are a full sync, false for recent catch-up
+  bool sync_resuming;            ///< true if we asked to continue an interrupted full sync
   version_t sync_start_version;  ///< last_committed at sync start
   Context *sync_timeout_event;   ///< timeout event
 
@@ -667,6 +671,22 @@ public:
     }
   } health_status_cache;
 
+  /**
+   * health reported by the paxos services, reused while paxos has not
+   * committed anything new, there has been no election (the quorum is
+   * part of the monmap health) and mon_health_cache_ttl has not expired.
+   */
+  struct service_health_cache_t {
+    version_t version;
+    epoch_t election_epoch;
+    utime_t stamp;
+    bool have_detail;
+    list<pair<health_status_t,string> > summary;
+    list<pair<health_status_t,string> > detail;
+
+    service_health_cache_t() : version(0), election_epoch(0), have_detail(false) { }
+  } service_health_cache;
+
   struct C_HealthToClogTick : public Context {
     Monitor *mon;
     C_HealthToClogTick(Monitor *m) : mon(m) { }
@@ -15,6 +15,7 @@
 
 #include "include/types.h"
 #include "include/buffer.h"
+#include "include/stringify.h"
 #include <set>
 #include <map>
 #include <string>
@@ -101,6 +102,7 @@ class MonitorDBStore
       OP_PUT	= 1,
       OP_ERASE	= 2,
       OP_COMPACT = 3,
+      OP_ERASE_RANGE = 4,
     };
 
     void put(string prefix, string key, bufferlist& bl) {
@@ -133,6 +135,22 @@ class MonitorDBStore
       erase(prefix, os.str());
     }
 
+    /**
+     * erase versions [from, to) of a prefix with a single op
+     *
+     * The op is expanded into individual key removals when the
+     * transaction is applied, so a large trim costs a couple of strings
+     * in the encoded proposal instead of one op per version.  Monitors
+     * that predate this op skip it without complaint when applying the
+     * transaction, so only use it once the quorum has
+     * CEPH_FEATURE_MON_TRIM_ERASE_RANGE.
+     */
+    void erase_range(string prefix, version_t from, version_t to) {
+      ops.push_back(Op(OP_ERASE_RANGE, prefix, stringify(from), stringify(to)));
+      keys += to - from;
+      bytes += prefix.length() + 2 * sizeof(version_t);
+    }
+
     void compact_prefix(string prefix) {
       ops.push_back(Op(OP_COMPACT, prefix, string()));
     }
@@ -168,6 +186,7 @@ class MonitorDBStore
       ls.back()->erase("prefix2", "key2");
       ls.back()->compact_prefix("prefix3");
       ls.back()->compact_range("prefix4", "from", "to");
+      ls.back()->erase_range("prefix5", 1, 10);
     }
 
     void append(TransactionRef other) {
@@ -227,6 +246,14 @@ class MonitorDBStore
 	    f->dump_string("key", op.key);
 	  }
 	  break;
+	case OP_ERASE_RANGE:
+	  {
+	    f->dump_string("type", "ERASE_RANGE");
+	    f->dump_string("prefix", op.prefix);
+	    f->dump_string("start", op.key);
+	    f->dump_string("end", op.endkey);
+	  }
+	  break;
 	case OP_COMPACT:
 	  {
 	    f->dump_string("type", "COMPACT");
@@ -272,6 +299,14 @@ class MonitorDBStore
       case Transaction::OP_ERASE:
 	dbt->rmkey(op.prefix, op.key);
 	break;
+      case Transaction::OP_ERASE_RANGE:
+	{
+	  version_t from = strtoull(op.key.c_str(), NULL, 10);
+	  version_t to = strtoull(op.endkey.c_str(), NULL, 10);
+	  for (version_t v = from; v < to; ++v)
+	    dbt->rmkey(op.prefix, stringify(v));
+	}
+	break;
       case Transaction::OP_COMPACT:
 	compact.push_back(make_pair(op.prefix, make_pair(op.key, op.endkey)));
 	break;
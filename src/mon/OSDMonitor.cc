@@ -217,14 +217,27 @@ void OSDMonitor::update_from_paxos(bool *need_bootstrap)
     // map with the same features as the incremental.  If we don't
     // know, use the quorum features.  If we don't know those either,
     // encode with all features.
-    uint64_t f = inc.encode_features;
-    if (!f)
-      f = mon->quorum_features;
-    if (!f)
-      f = -1;
     bufferlist full_bl;
-    osdmap.encode(full_bl, f | CEPH_FEATURE_RESERVED);
-    tx_size += full_bl.length();
+    if (inc.have_crc && inc.epoch == pending_full_epoch &&
+	inc.inc_crc == pending_full_inc_crc) {
+      // this is our own proposal; encode_pending already encoded the
+      // resulting full map and committed it, so take its crc and buffer.
+      dout(10) << __func__ << " reusing full map e" << inc.epoch
+	       << " encoded by encode_pending" << dendl;
+      osdmap.crc = pending_full_crc;
+      osdmap.crc_defined = true;
+      full_osd_cache.add(osdmap.epoch, pending_full_bl);
+      pending_full_bl.clear();
+      pending_full_epoch = 0;
+    } else {
+      uint64_t f = inc.encode_features;
+      if (!f)
+	f = mon->quorum_features;
+      if (!f)
+	f = -1;
+      osdmap.encode(full_bl, f | CEPH_FEATURE_RESERVED);
+      tx_size += full_bl.length();
+    }
 
     bufferlist orig_full_bl;
     get_version_full(osdmap.epoch, orig_full_bl);
@@ -879,6 +892,7 @@ void OSDMonitor::create_pending()
 {
   pending_inc = OSDMap::Incremental(osdmap.epoch+1);
   pending_inc.fsid = mon->monmap->fsid;
+  pending_failure_stamp = utime_t();
   
   dout(10) << "create_pending e " << pending_inc.epoch << dendl;
 
@@ -936,10 +950,10 @@ void OSDMonitor::encode_pending(MonitorDBStore::TransactionRef t)
 
   // encode full map and determine its crc
   OSDMap tmp;
+  bufferlist fullbl;
   {
     tmp.deepish_copy_from(osdmap);
     tmp.apply_incremental(pending_inc);
-    bufferlist fullbl;
     ::encode(tmp, fullbl, mon->quorum_features | CEPH_FEATURE_RESERVED);
     pending_inc.full_crc = tmp.get_crc();
 
@@ -953,6 +967,12 @@ void OSDMonitor::encode_pending(MonitorDBStore::TransactionRef t)
   assert(get_last_committed() + 1 == pending_inc.epoch);
   ::encode(pending_inc, bl, mon->quorum_features | CEPH_FEATURE_RESERVED);
 
+  // remember what we proposed so update_from_paxos can skip the re-encode
+  pending_full_epoch = pending_inc.epoch;
+  pending_full_inc_crc = pending_inc.inc_crc;
+  pending_full_crc = tmp.get_crc();
+  pending_full_bl.claim(fullbl);
+
   dout(20) << " full_crc " << tmp.get_crc()
 	   << " inc_crc " << pending_inc.inc_crc << dendl;
 
@@ -1138,9 +1158,46 @@ bool OSDMonitor::should_propose(double& delay)
     return true;
   }
 
+  // hold newly failed osds for a moment so that a burst of failures
+  // (e.g., a host or rack) lands in a single epoch.
+  double left = failure_hold_left(ceph_clock_now(g_ceph_context));
+  if (left > 0) {
+    bool r = PaxosService::should_propose(delay);
+    if (delay < left) {
+      dout(10) << " holding failures for another " << left << "s" << dendl;
+      delay = left;
+    }
+    return r;
+  }
+
   return PaxosService::should_propose(delay);
 }
 
+/*
+ * how much longer a proposal marking osds down should be held for
+ * mon_osd_failure_batch_interval, or 0 if it need not be held.
+ */
+double OSDMonitor::failure_hold_left(utime_t now)
+{
+  if (g_conf->mon_osd_failure_batch_interval <= 0 ||
+      pending_failure_stamp == utime_t())
+    return 0;
+  double left = g_conf->mon_osd_failure_batch_interval -
+    (double)(now - pending_failure_stamp);
+  return left > 0 ? left : 0;
+}
+
+void OSDMonitor::propose_or_hold(utime_t now)
+{
+  double left = failure_hold_left(now);
+  if (left > 0) {
+    dout(10) << " holding failures for another " << left << "s" << dendl;
+    reschedule_proposal(left);
+    return;
+  }
+  propose_pending();
+}
+
 
 
 // ---------------------------
@@ -1468,6 +1525,13 @@ bool OSDMonitor::check_failure(utime_t now, int target_osd, failure_info_t& fi)
       (fi.num_reports >= g_conf->mon_osd_min_down_reports)) {
     dout(1) << " we have enough reports/reporters to mark osd." << target_osd << " down" << dendl;
     pending_inc.new_state[target_osd] = CEPH_OSD_UP;
+    if (pending_failure_stamp == utime_t()) {
+      pending_failure_stamp = now;
+      // an earlier update may already have set a shorter proposal
+      // timer; push it out so the failures are still held.
+      if (g_conf->mon_osd_failure_batch_interval > 0)
+	reschedule_proposal(g_conf->mon_osd_failure_batch_interval);
+    }
 
     mon->clog->info() << osdmap.get_inst(target_osd) << " failed ("
 		     << fi.num_reports << " reports from " << (int)fi.reporters.size() << " peers after "
@@ -2060,6 +2124,26 @@ void OSDMonitor::send_latest(PaxosServiceMessage *m, epoch_t start)
 }
 
 
+int OSDMonitor::get_version(version_t ver, bufferlist& bl)
+{
+  if (inc_osd_cache.lookup(ver, &bl))
+    return 0;
+  int ret = PaxosService::get_version(ver, bl);
+  if (!ret)
+    inc_osd_cache.add(ver, bl);
+  return ret;
+}
+
+int OSDMonitor::get_version_full(version_t ver, bufferlist& bl)
+{
+  if (full_osd_cache.lookup(ver, &bl))
+    return 0;
+  int ret = PaxosService::get_version_full(ver, bl);
+  if (!ret)
+    full_osd_cache.add(ver, bl);
+  return ret;
+}
+
 MOSDMap *OSDMonitor::build_latest_full()
 {
   MOSDMap *r = new MOSDMap(mon->monmap->fsid);
@@ -2419,7 +2503,7 @@ void OSDMonitor::tick()
 
   if (do_propose ||
       !pending_inc.new_pg_temp.empty())  // also propose if we adjusted pg_temp
-    propose_pending();
+    propose_or_hold(now);
 }
 
 void OSDMonitor::handle_osd_timeouts(const utime_t &now,
@@ -2451,7 +2535,7 @@ void OSDMonitor::handle_osd_timeouts(const utime_t &now,
     }
   }
   if (new_down) {
-    propose_pending();
+    propose_or_hold(now);
   }
 }
 
@@ -26,6 +26,7 @@
 using namespace std;
 
 #include "include/types.h"
+#include "common/simple_cache.hpp"
 #include "msg/Messenger.h"
 
 #include "osd/OSDMap.h"
@@ -140,8 +141,33 @@ private:
    */
   map<int,epoch_t> osd_epoch;
 
+  /*
+   * encoded maps by epoch.  a map bump sends the same few epochs to
+   * every subscriber; serve them from memory and share the buffers.
+   */
+  SimpleLRU<version_t, bufferlist> inc_osd_cache;
+  SimpleLRU<version_t, bufferlist> full_osd_cache;
+
+  /*
+   * full map encoded by encode_pending for the epoch we proposed.  if
+   * that proposal commits, update_from_paxos reuses it instead of
+   * encoding the same map again to verify its crc.
+   */
+  epoch_t pending_full_epoch;
+  uint32_t pending_full_inc_crc;
+  uint32_t pending_full_crc;
+  bufferlist pending_full_bl;
+
   void note_osd_has_epoch(int osd, epoch_t epoch);
 
+  /*
+   * when the first osd was marked down in pending_inc; used to hold the
+   * proposal for mon_osd_failure_batch_interval.
+   */
+  utime_t pending_failure_stamp;
+  double failure_hold_left(utime_t now);
+  void propose_or_hold(utime_t now);
+
   void check_failures(utime_t now);
   bool check_failure(utime_t now, int target_osd, failure_info_t& fi);
 
@@ -382,8 +408,14 @@ private:
  public:
   OSDMonitor(Monitor *mn, Paxos *p, string service_name)
   : PaxosService(mn, p, service_name),
+    inc_osd_cache(g_conf->mon_osd_cache_size),
+    full_osd_cache(g_conf->mon_osd_cache_size),
+    pending_full_epoch(0), pending_full_inc_crc(0), pending_full_crc(0),
     thrash_map(0), thrash_last_up_osd(-1) { }
 
+  int get_version(version_t ver, bufferlist& bl);
+  int get_version_full(version_t ver, bufferlist& bl);
+
   void tick();  // check state, take actions
 
   int parse_osd_id(const char *s, stringstream *pss);
@@ -355,6 +355,7 @@ void PGMap::register_nearfull_status(int osd, const osd_stat_t& s)
 void PGMap::calc_stats()
 {
   num_pg_by_state.clear();
+  unhealthy_pgs.clear();
   num_pg = 0;
   num_osd = 0;
   pg_pool_sum.clear();
@@ -466,6 +467,8 @@ void PGMap::stat_pg_add(const pg_t &pgid, const pg_stat_t &s, bool sumonly)
 
   num_pg++;
   num_pg_by_state[s.state]++;
+  if (is_unhealthy(s.state))
+    unhealthy_pgs.insert(pgid);
 
   if (s.state & PG_STATE_CREATING) {
     creating_pgs.insert(pgid);
@@ -493,6 +496,8 @@ void PGMap::stat_pg_sub(const pg_t &pgid, const pg_stat_t &s, bool sumonly)
   num_pg--;
   if (--num_pg_by_state[s.state] == 0)
     num_pg_by_state.erase(s.state);
+  if (is_unhealthy(s.state))
+    unhealthy_pgs.erase(pgid);
 
   if (s.state & PG_STATE_CREATING) {
     creating_pgs.erase(pgid);
@@ -855,9 +860,12 @@ void PGMap::dump_osd_sum_stats(ostream& ss) const
 void PGMap::get_stuck_stats(PGMap::StuckPG type, utime_t cutoff,
 			    ceph::unordered_map<pg_t, pg_stat_t>& stuck_pgs) const
 {
-  for (ceph::unordered_map<pg_t, pg_stat_t>::const_iterator i = pg_stat.begin();
-       i != pg_stat.end();
-       ++i) {
+  // a healthy pg can't be stuck in any of these states
+  for (ceph::unordered_set<pg_t>::const_iterator u = unhealthy_pgs.begin();
+       u != unhealthy_pgs.end();
+       ++u) {
+    ceph::unordered_map<pg_t, pg_stat_t>::const_iterator i = pg_stat.find(*u);
+    assert(i != pg_stat.end());
     utime_t val;
     switch (type) {
     case STUCK_INACTIVE:
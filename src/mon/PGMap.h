@@ -24,6 +24,7 @@
 #include "common/debug.h"
 #include "osd/osd_types.h"
 #include "common/config.h"
+#include "include/unordered_set.h"
 #include <sstream>
 
 #include "MonitorDBStore.h"
@@ -183,6 +184,33 @@ public:
   set<pg_t> creating_pgs;   // lru: front = new additions, back = recently pinged
   map<int,set<pg_t> > creating_pgs_by_osd;
 
+  /// pgs that are not active+clean or carry a state health reports on.
+  /// Only these can be stuck or appear in health detail, so the health
+  /// and stuck checks walk this set instead of every pg.
+  ceph::unordered_set<pg_t> unhealthy_pgs;
+
+  static const int UNHEALTHY_STATES =
+    PG_STATE_STALE |
+    PG_STATE_DOWN |
+    PG_STATE_UNDERSIZED |
+    PG_STATE_DEGRADED |
+    PG_STATE_INCONSISTENT |
+    PG_STATE_PEERING |
+    PG_STATE_REPAIR |
+    PG_STATE_SPLITTING |
+    PG_STATE_RECOVERING |
+    PG_STATE_RECOVERY_WAIT |
+    PG_STATE_INCOMPLETE |
+    PG_STATE_BACKFILL_WAIT |
+    PG_STATE_BACKFILL |
+    PG_STATE_BACKFILL_TOOFULL;
+
+  static bool is_unhealthy(int state) {
+    return (state & (PG_STATE_ACTIVE | PG_STATE_CLEAN)) !=
+      (PG_STATE_ACTIVE | PG_STATE_CLEAN) ||
+      (state & UNHEALTHY_STATES);
+  }
+
   enum StuckPG {
     STUCK_INACTIVE,
     STUCK_UNCLEAN,
@@ -68,6 +68,29 @@ void PGMonitor::on_restart()
   // clear leader state
   last_sent_pg_create.clear();
   last_osd_report.clear();
+
+  // osds were not acked for these and will report again; the new leader
+  // may be someone else
+  unflushed_pg_stats.clear();
+  unflushed_osd_stats.clear();
+  drop_unflushed_acks();
+}
+
+void PGMonitor::on_shutdown()
+{
+  drop_unflushed_acks();
+}
+
+void PGMonitor::drop_unflushed_acks()
+{
+  for (list<pair<MPGStats*,MPGStatsAck*> >::iterator p =
+	 unflushed_acks.begin();
+       p != unflushed_acks.end();
+       ++p) {
+    p->first->put();
+    p->second->put();
+  }
+  unflushed_acks.clear();
 }
 
 void PGMonitor::on_active()
@@ -130,6 +153,14 @@ void PGMonitor::tick()
     
     if (need_check_down_pgs && check_down_pgs())
       propose = true;
+
+    if ((!unflushed_pg_stats.empty() || !unflushed_osd_stats.empty() ||
+	 !unflushed_acks.empty()) &&
+	is_writeable() &&
+	(double)(ceph_clock_now(g_ceph_context) - last_stats_flush) >=
+	  g_conf->mon_pg_stats_flush_interval &&
+	flush_stats())
+      propose = true;
     
     if (propose) {
       propose_pending();
@@ -777,12 +808,20 @@ bool PGMonitor::prepare_pg_stats(MPGStats *stats)
     return false;
   }
 
+  // with a flush interval we ack right away and only commit stats
+  // periodically; they are only needed approximately.  pg state
+  // changes still go out with the next proposal.
+  bool defer = g_conf->mon_pg_stats_flush_interval > 0;
+  bool state_changed = false;
+
   // osd stat
-  if (mon->osdmon()->osdmap.is_in(from)) {
-    pending_inc.update_stat(from, stats->epoch, stats->osd_stat);
-  } else {
-    pending_inc.update_stat(from, stats->epoch, osd_stat_t());
-  }
+  osd_stat_t osd_stat;
+  if (mon->osdmon()->osdmap.is_in(from))
+    osd_stat = stats->osd_stat;
+  if (defer)
+    unflushed_osd_stats[from] = make_pair(stats->epoch, osd_stat);
+  else
+    pending_inc.update_stat(from, stats->epoch, osd_stat);
   
   if (pg_map.osd_stat.count(from))
     dout(10) << " got osd." << from << " " << stats->osd_stat << " (was " << pg_map.osd_stat[from] << ")" << dendl;
@@ -810,6 +849,13 @@ bool PGMonitor::prepare_pg_stats(MPGStats *stats)
 	       << pending_inc.pg_stat_updates[pgid].reported_seq << " (pending)" << dendl;
       continue;
     }
+    map<pg_t,pg_stat_t>::iterator u = unflushed_pg_stats.find(pgid);
+    if (u != unflushed_pg_stats.end() &&
+	u->second.get_version_pair() > p->second.get_version_pair()) {
+      dout(15) << " had " << pgid << " from " << u->second.reported_epoch << ":"
+	       << u->second.reported_seq << " (unflushed)" << dendl;
+      continue;
+    }
 
     if (pg_map.pg_stat.count(pgid) == 0) {
       dout(15) << " got " << pgid << " reported at " << p->second.reported_epoch << ":"
@@ -825,7 +871,13 @@ bool PGMonitor::prepare_pg_stats(MPGStats *stats)
 	     << " state " << pg_state_string(pg_map.pg_stat[pgid].state)
 	     << " -> " << pg_state_string(p->second.state)
 	     << dendl;
-    pending_inc.pg_stat_updates[pgid] = p->second;
+    if (defer) {
+      unflushed_pg_stats[pgid] = p->second;
+      if (pg_map.pg_stat[pgid].state != p->second.state)
+	state_changed = true;
+    } else {
+      pending_inc.pg_stat_updates[pgid] = p->second;
+    }
 
     /*
     // we don't care much about consistency, here; apply to live map.
@@ -835,10 +887,67 @@ bool PGMonitor::prepare_pg_stats(MPGStats *stats)
     */
   }
   
+  if (defer) {
+    // hold the ack until the flush commits; the osd drops acked pgs from
+    // its report queue, so it must not hear back before they are durable
+    unflushed_acks.push_back(make_pair(stats, ack));
+    if (state_changed ||
+	(double)(ceph_clock_now(g_ceph_context) - last_stats_flush) >=
+	  g_conf->mon_pg_stats_flush_interval)
+      return flush_stats();
+    return false;
+  }
+
   wait_for_finished_proposal(new C_Stats(this, stats, ack));
   return true;
 }
 
+bool PGMonitor::flush_stats()
+{
+  dout(10) << __func__ << " " << unflushed_pg_stats.size() << " pgs, "
+	   << unflushed_osd_stats.size() << " osds" << dendl;
+  last_stats_flush = ceph_clock_now(g_ceph_context);
+  bool changed = false;
+
+  for (list<pair<MPGStats*,MPGStatsAck*> >::iterator p =
+	 unflushed_acks.begin();
+       p != unflushed_acks.end();
+       ++p) {
+    wait_for_finished_proposal(new C_Stats(this, p->first, p->second));
+    changed = true;
+  }
+  unflushed_acks.clear();
+
+  for (map<int32_t,pair<epoch_t,osd_stat_t> >::iterator p =
+	 unflushed_osd_stats.begin();
+       p != unflushed_osd_stats.end();
+       ++p) {
+    // osds that went down since they reported are dropped by the osdmap
+    // handling; don't resurrect them
+    if (!mon->osdmon()->osdmap.is_up(p->first))
+      continue;
+    pending_inc.update_stat(p->first, p->second.first, p->second.second);
+    changed = true;
+  }
+  unflushed_osd_stats.clear();
+
+  for (map<pg_t,pg_stat_t>::iterator p = unflushed_pg_stats.begin();
+       p != unflushed_pg_stats.end();
+       ++p) {
+    if (pg_map.pg_stat.count(p->first) == 0)
+      continue;  // pool deleted meanwhile
+    map<pg_t,pg_stat_t>::iterator q = pending_inc.pg_stat_updates.find(p->first);
+    if (q != pending_inc.pg_stat_updates.end() &&
+	q->second.get_version_pair() > p->second.get_version_pair())
+      continue;
+    pending_inc.pg_stat_updates[p->first] = p->second;
+    changed = true;
+  }
+  unflushed_pg_stats.clear();
+
+  return changed;
+}
+
 void PGMonitor::_updated_stats(MPGStats *req, MPGStatsAck *ack)
 {
   dout(7) << "_updated_stats for " << req->get_orig_source_inst() << dendl;
@@ -2021,23 +2130,12 @@ void PGMonitor::get_health(list<pair<health_status_t,string> >& summary,
       summary.push_back(make_pair(HEALTH_WARN, ss.str()));
     }
     if (detail) {
-      for (ceph::unordered_map<pg_t,pg_stat_t>::const_iterator p = pg_map.pg_stat.begin();
-	   p != pg_map.pg_stat.end();
-	   ++p) {
-	if ((p->second.state & (PG_STATE_STALE |
-			       PG_STATE_DOWN |
-			       PG_STATE_UNDERSIZED |
-			       PG_STATE_DEGRADED |
-			       PG_STATE_INCONSISTENT |
-			       PG_STATE_PEERING |
-			       PG_STATE_REPAIR |
-			       PG_STATE_SPLITTING |
-			       PG_STATE_RECOVERING |
-			       PG_STATE_RECOVERY_WAIT |
-			       PG_STATE_INCOMPLETE |
-			       PG_STATE_BACKFILL_WAIT |
-			       PG_STATE_BACKFILL |
-			       PG_STATE_BACKFILL_TOOFULL)) &&
+      for (ceph::unordered_set<pg_t>::const_iterator u = pg_map.unhealthy_pgs.begin();
+	   u != pg_map.unhealthy_pgs.end();
+	   ++u) {
+	ceph::unordered_map<pg_t,pg_stat_t>::const_iterator p = pg_map.pg_stat.find(*u);
+	assert(p != pg_map.pg_stat.end());
+	if ((p->second.state & PGMap::UNHEALTHY_STATES) &&
 	    stuck_pgs.count(p->first) == 0) {
 	  ostringstream ss;
 	  ss << "pg " << p->first << " is " << pg_state_string(p->second.state);
@@ -82,6 +82,21 @@ private:
   bool prepare_pg_stats(MPGStats *stats);
   void _updated_stats(MPGStats *req, MPGStatsAck *ack);
 
+  // stats not yet folded into pending_inc (mon_pg_stats_flush_interval),
+  // and the reports whose acks wait for the flush to commit
+  map<pg_t,pg_stat_t> unflushed_pg_stats;
+  map<int32_t,pair<epoch_t,osd_stat_t> > unflushed_osd_stats;
+  list<pair<MPGStats*,MPGStatsAck*> > unflushed_acks;
+  utime_t last_stats_flush;
+
+  /**
+   * move unflushed stats into pending_inc
+   *
+   * @return true if we updated pending_inc (and should propose)
+   */
+  bool flush_stats();
+  void drop_unflushed_acks();
+
   struct C_Stats : public Context {
     PGMonitor *pgmon;
     MPGStats *req;
@@ -171,6 +186,7 @@ public:
   }
 
   virtual void on_restart();
+  virtual void on_shutdown();
 
   /* Courtesy function provided by PaxosService, called when an election
    * finishes and the cluster goes active. We use it here to make sure we
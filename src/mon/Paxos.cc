@@ -110,6 +110,10 @@ void Paxos::init_logger()
   pcb.add_u64_avg(l_paxos_share_state_bytes, "share_state_bytes");
   pcb.add_u64_counter(l_paxos_new_pn, "new_pn");
   pcb.add_time_avg(l_paxos_new_pn_latency, "new_pn_latency");
+  pcb.add_u64_avg(l_paxos_propose_batch, "propose_batch",
+      "Service transactions per proposal");
+  pcb.add_time_avg(l_paxos_round_latency, "round_latency",
+      "Proposal to commit latency", "rlat");
   logger = pcb.create_perf_counters();
   g_ceph_context->get_perfcounters_collection()->add(logger);
 }
@@ -1028,6 +1032,8 @@ void Paxos::commit_proposal()
   assert(mon->is_leader());
   assert(is_refresh());
 
+  logger->tinc(l_paxos_round_latency, ceph_clock_now(NULL) - proposal_start);
+
   list<Context*> ls;
   ls.swap(committing_finishers);
   finish_contexts(g_ceph_context, ls);
@@ -1195,14 +1201,29 @@ void Paxos::trim()
 
   MonitorDBStore::TransactionRef t = get_pending_transaction();
 
-  for (version_t v = first_committed; v < end; ++v) {
-    dout(10) << "trim " << v << dendl;
-    t->erase(get_name(), v);
+  if (g_conf->mon_trim_erase_range &&
+      (mon->get_quorum_features() & CEPH_FEATURE_MON_TRIM_ERASE_RANGE)) {
+    t->erase_range(get_name(), first_committed, end);
+  } else {
+    for (version_t v = first_committed; v < end; ++v) {
+      dout(10) << "trim " << v << dendl;
+      t->erase(get_name(), v);
+    }
   }
   t->put(get_name(), "first_committed", end);
+  mon->logger->inc(l_mon_trim_keys, end - first_committed);
+
   if (g_conf->mon_compact_on_trim) {
-    dout(10) << " compacting trimmed range" << dendl;
-    t->compact_range(get_name(), stringify(first_committed - 1), stringify(end));
+    if (!trim_compact_from || trim_compact_from > first_committed)
+      trim_compact_from = first_committed;
+    if (end - trim_compact_from >= (version_t)g_conf->mon_compact_on_trim_min) {
+      dout(10) << " compacting trimmed range " << trim_compact_from
+	       << " to " << end << dendl;
+      t->compact_range(get_name(), stringify(trim_compact_from - 1),
+		       stringify(end));
+      mon->logger->inc(l_mon_trim_compact);
+      trim_compact_from = 0;
+    }
   }
 
   trimming = true;
@@ -1268,6 +1289,10 @@ void Paxos::cancel_events()
     mon->timer.cancel_event(lease_timeout_event);
     lease_timeout_event = 0;
   }
+  if (propose_event) {
+    mon->timer.cancel_event(propose_event);
+    propose_event = 0;
+  }
 }
 
 void Paxos::shutdown()
@@ -1494,6 +1519,8 @@ void Paxos::propose_pending()
   *_dout << dendl;
 
   committing_finishers.swap(pending_finishers);
+  logger->inc(l_paxos_propose_batch, committing_finishers.size());
+  proposal_start = ceph_clock_now(NULL);
   state = STATE_UPDATING;
   begin(bl);
 }
@@ -1517,7 +1544,17 @@ MonitorDBStore::TransactionRef Paxos::get_pending_transaction()
 
 bool Paxos::trigger_propose()
 {
-  if (is_active()) {
+  if (propose_event) {
+    dout(10) << __func__ << " batch already scheduled" << dendl;
+    return true;
+  } else if (is_active() && g_conf->paxos_propose_batch_delay > 0) {
+    dout(10) << __func__ << " active, proposing in "
+	     << g_conf->paxos_propose_batch_delay << dendl;
+    propose_event = new C_Propose(this);
+    mon->timer.add_event_after(g_conf->paxos_propose_batch_delay,
+			       propose_event);
+    return true;
+  } else if (is_active()) {
     dout(10) << __func__ << " active, proposing now" << dendl;
     propose_pending();
     return true;
@@ -160,6 +160,8 @@ enum {
   l_paxos_share_state_bytes,
   l_paxos_new_pn,
   l_paxos_new_pn_latency,
+  l_paxos_propose_batch,
+  l_paxos_round_latency,
   l_paxos_last,
 };
 
@@ -517,6 +519,15 @@ private:
    * beginning).
    */
   Context    *lease_timeout_event;
+  /**
+   * Callback to propose the pending transaction once the batch window
+   * (paxos_propose_batch_delay) closes.
+   */
+  Context    *propose_event;
+  /**
+   * When the proposal in flight was started; for round latency.
+   */
+  utime_t proposal_start;
   /**
    * @}
    */
@@ -618,6 +629,12 @@ private:
    */
   bool trimming;
 
+  /**
+   * First version trimmed since we last queued a compaction of the trimmed
+   * range; zero if nothing is pending.  See mon_compact_on_trim_min.
+   */
+  version_t trim_compact_from;
+
   /**
    * @defgroup Paxos_h_callbacks Callback classes.
    * @{
@@ -692,6 +709,22 @@ private:
     }
   };
 
+  /**
+   * Callback class responsible for proposing a batched transaction.
+   */
+  class C_Propose : public Context {
+    Paxos *paxos;
+  public:
+    C_Propose(Paxos *p) : paxos(p) {}
+    void finish(int r) {
+      if (r == -ECANCELED)
+	return;
+      paxos->propose_event = 0;
+      if (paxos->is_active() && paxos->pending_proposal)
+	paxos->propose_pending();
+    }
+  };
+
   class C_Trimmed : public Context {
     Paxos *paxos;
   public:
@@ -1103,9 +1136,11 @@ public:
 		   lease_renew_event(0),
 		   lease_ack_timeout_event(0),
 		   lease_timeout_event(0),
+		   propose_event(0),
 		   accept_timeout_event(0),
 		   clock_drift_warned(0),
-		   trimming(false) { }
+		   trimming(false),
+		   trim_compact_from(0) { }
 
   const string get_name() const {
     return paxos_name;
@@ -1366,6 +1401,8 @@ public:
    * Tell paxos that it should submit the pending proposal.  Note that if it
    * is not active (e.g., because it is already in the midst of committing
    * something) that will be deferred (e.g., until the current round finishes).
+   * If paxos_propose_batch_delay is set, an idle leader also holds off for
+   * that long so transactions from other services share the round.
    */
   bool trigger_propose();
 
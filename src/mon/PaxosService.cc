@@ -166,6 +166,17 @@ bool PaxosService::should_propose(double& delay)
 }
 
 
+void PaxosService::reschedule_proposal(double delay)
+{
+  if (proposal_timer) {
+    dout(10) << " canceling proposal_timer " << proposal_timer << dendl;
+    mon->timer.cancel_event(proposal_timer);
+  }
+  proposal_timer = new C_Propose(this);
+  dout(10) << " setting proposal_timer " << proposal_timer << " with delay of " << delay << dendl;
+  mon->timer.add_event_after(delay, proposal_timer);
+}
+
 void PaxosService::propose_pending()
 {
   dout(10) << "propose_pending" << dendl;
@@ -360,9 +371,16 @@ void PaxosService::trim(MonitorDBStore::TransactionRef t,
   dout(10) << __func__ << " from " << from << " to " << to << dendl;
   assert(from != to);
 
+  bool erase_range = g_conf->mon_trim_erase_range &&
+    (mon->get_quorum_features() & CEPH_FEATURE_MON_TRIM_ERASE_RANGE);
+  if (erase_range)
+    t->erase_range(get_service_name(), from, to);
+
   for (version_t v = from; v < to; ++v) {
-    dout(20) << __func__ << " " << v << dendl;
-    t->erase(get_service_name(), v);
+    if (!erase_range) {
+      dout(20) << __func__ << " " << v << dendl;
+      t->erase(get_service_name(), v);
+    }
 
     string full_key = mon->store->combine_strings("full", v);
     if (mon->store->exists(get_service_name(), full_key)) {
@@ -370,9 +388,19 @@ void PaxosService::trim(MonitorDBStore::TransactionRef t,
       t->erase(get_service_name(), full_key);
     }
   }
+  mon->logger->inc(l_mon_trim_keys, to - from);
+
   if (g_conf->mon_compact_on_trim) {
-    dout(20) << " compacting prefix " << get_service_name() << dendl;
-    t->compact_range(get_service_name(), stringify(from - 1), stringify(to));
+    if (!trim_compact_from || trim_compact_from > from)
+      trim_compact_from = from;
+    if (to - trim_compact_from >= (version_t)g_conf->mon_compact_on_trim_min) {
+      dout(20) << " compacting prefix " << get_service_name()
+	       << " from " << trim_compact_from << " to " << to << dendl;
+      t->compact_range(get_service_name(), stringify(trim_compact_from - 1),
+		       stringify(to));
+      mon->logger->inc(l_mon_trim_compact);
+      trim_compact_from = 0;
+    }
   }
 }
 
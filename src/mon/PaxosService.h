@@ -198,7 +198,8 @@ public:
       last_committed_name("last_committed"),
       first_committed_name("first_committed"),
       full_prefix_name("full"), full_latest_name("latest"),
-      cached_first_committed(0), cached_last_committed(0)
+      cached_first_committed(0), cached_last_committed(0),
+      trim_compact_from(0)
   {
   }
 
@@ -283,6 +284,12 @@ public:
    */
   void propose_pending();
 
+  /**
+   * Propose after @p delay seconds, replacing the proposal timer if one
+   * is already set.
+   */
+  void reschedule_proposal(double delay);
+
   /**
    * Let others request us to propose.
    *
@@ -521,6 +528,12 @@ public:
    * @}
    */
 
+  /**
+   * First version trimmed since we last queued a compaction of our prefix;
+   * zero if nothing is pending.  See mon_compact_on_trim_min.
+   */
+  version_t trim_compact_from;
+
   /**
    * Callback list to be used whenever we are running a proposal through
    * Paxos. These callbacks will be awaken whenever the said proposal
@@ -858,7 +871,7 @@ public:
    * @param bl The bufferlist to be populated
    * @return 0 on success; <0 otherwise
    */
-  int get_version(version_t ver, bufferlist& bl) {
+  virtual int get_version(version_t ver, bufferlist& bl) {
     return mon->store->get(get_service_name(), ver, bl);
   }
   /**
@@ -868,7 +881,7 @@ public:
    * @param bl The bufferlist to be populated
    * @returns 0 on success; <0 otherwise
    */
-  int get_version_full(version_t ver, bufferlist& bl) {
+  virtual int get_version_full(version_t ver, bufferlist& bl) {
     string key = mon->store->combine_strings(full_prefix_name, ver);
     return mon->store->get(get_service_name(), key, bl);
   }
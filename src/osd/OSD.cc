@@ -2070,7 +2070,7 @@ void OSD::create_logger()
       "Client operations total write size", "wr");       // client op in bytes (writes)
   osd_plb.add_u64_counter(l_osd_op_outb,  "op_out_bytes",
       "Client operations total read size", "rd");      // client op out bytes (reads)
-  osd_plb.add_time_avg(l_osd_op_lat,   "op_latency", 
+  osd_plb.add_time_hist(l_osd_op_lat,  "op_latency", 
       "Latency of client operations (including queue time)", "lat");       // client op latency
   osd_plb.add_time_avg(l_osd_op_process_lat, "op_process_latency", 
       "Latency of client operations (excluding queue time)");   // client op process latency
@@ -2079,7 +2079,7 @@ void OSD::create_logger()
       "Client read operations");        // client reads
   osd_plb.add_u64_counter(l_osd_op_r_outb, "op_r_out_bytes", 
       "Client data read");   // client read out bytes
-  osd_plb.add_time_avg(l_osd_op_r_lat,  "op_r_latency", 
+  osd_plb.add_time_hist(l_osd_op_r_lat, "op_r_latency", 
       "Latency of read operation (including queue time)");    // client read latency
   osd_plb.add_time_avg(l_osd_op_r_process_lat, "op_r_process_latency", 
       "Latency of read operation (excluding queue time)");   // client read process latency
@@ -2089,7 +2089,7 @@ void OSD::create_logger()
       "Client data written");    // client write in bytes
   osd_plb.add_time_avg(l_osd_op_w_rlat, "op_w_rlat", 
       "Client write operation readable/applied latency");   // client write readable/applied latency
-  osd_plb.add_time_avg(l_osd_op_w_lat,  "op_w_latency", 
+  osd_plb.add_time_hist(l_osd_op_w_lat, "op_w_latency", 
       "Latency of write operation (including queue time)");    // client write latency
   osd_plb.add_time_avg(l_osd_op_w_process_lat, "op_w_process_latency", 
       "Latency of write operation (excluding queue time)");   // client write process latency
@@ -2101,11 +2101,33 @@ void OSD::create_logger()
       "Client read-modify-write operations read out ");  // client rmw out bytes
   osd_plb.add_time_avg(l_osd_op_rw_rlat,"op_rw_rlat", 
       "Client read-modify-write operation readable/applied latency");  // client rmw readable/applied latency
-  osd_plb.add_time_avg(l_osd_op_rw_lat, "op_rw_latency", 
+  osd_plb.add_time_hist(l_osd_op_rw_lat, "op_rw_latency", 
       "Latency of read-modify-write operation (including queue time)");   // client rmw latency
   osd_plb.add_time_avg(l_osd_op_rw_process_lat, "op_rw_process_latency", 
       "Latency of read-modify-write operation (excluding queue time)");   // client rmw process latency
 
+  perf_histogram_axis_d lat_axis = {
+    "latency_usec", perf_histogram_axis_d::SCALE_LOG2, 0, 100, 20
+  };
+  perf_histogram_axis_d size_axis = {
+    "size_bytes", perf_histogram_axis_d::SCALE_LOG2, 0, 512, 16
+  };
+  osd_plb.add_histogram_2d(l_osd_op_queue_lat_size_hist,
+      "op_queue_latency_size_histogram", lat_axis, size_axis,
+      "Queue latency of operations by request data size");
+  osd_plb.add_histogram_2d(l_osd_op_r_lat_outb_hist,
+      "op_r_latency_out_bytes_histogram", lat_axis, size_axis,
+      "Latency of read operation by size read");
+  osd_plb.add_histogram_2d(l_osd_op_w_lat_inb_hist,
+      "op_w_latency_in_bytes_histogram", lat_axis, size_axis,
+      "Latency of write operation by size written");
+  osd_plb.add_histogram_2d(l_osd_op_rw_lat_inb_hist,
+      "op_rw_latency_in_bytes_histogram", lat_axis, size_axis,
+      "Latency of read-modify-write operation by size written");
+  osd_plb.add_histogram_2d(l_osd_op_rw_lat_outb_hist,
+      "op_rw_latency_out_bytes_histogram", lat_axis, size_axis,
+      "Latency of read-modify-write operation by size read");
+
   osd_plb.add_u64_counter(l_osd_sop,       "subop");         // subops
   osd_plb.add_u64_counter(l_osd_sop_inb,   "subop_in_bytes");     // subop in bytes
   osd_plb.add_time_avg(l_osd_sop_lat,   "subop_latency");     // subop latency
@@ -8372,6 +8394,8 @@ void OSD::dequeue_op(
 	   << " latency " << latency
 	   << " " << *(op->get_req())
 	   << " pg " << *pg << dendl;
+  logger->hinc(l_osd_op_queue_lat_size_hist, latency.to_nsec() / 1000,
+	       op->get_req()->get_data_len());
 
   // share our map with sender, if they're old
   if (op->send_map_update) {
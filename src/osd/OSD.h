@@ -81,6 +81,11 @@ enum {
   l_osd_op_rw_rlat,
   l_osd_op_rw_lat,
   l_osd_op_rw_process_lat,
+  l_osd_op_queue_lat_size_hist,
+  l_osd_op_r_lat_outb_hist,
+  l_osd_op_w_lat_inb_hist,
+  l_osd_op_rw_lat_inb_hist,
+  l_osd_op_rw_lat_outb_hist,
 
   l_osd_sop,
   l_osd_sop_inb,
@@ -2468,6 +2468,7 @@ void ReplicatedPG::log_op_stats(OpContext *ctx)
 
   uint64_t inb = ctx->bytes_written;
   uint64_t outb = ctx->bytes_read;
+  int64_t lat_usec = latency.to_nsec() / 1000;
 
   osd->logger->inc(l_osd_op);
 
@@ -2482,6 +2483,8 @@ void ReplicatedPG::log_op_stats(OpContext *ctx)
     osd->logger->inc(l_osd_op_rw_outb, outb);
     osd->logger->tinc(l_osd_op_rw_lat, latency);
     osd->logger->tinc(l_osd_op_rw_process_lat, process_latency);
+    osd->logger->hinc(l_osd_op_rw_lat_inb_hist, lat_usec, inb);
+    osd->logger->hinc(l_osd_op_rw_lat_outb_hist, lat_usec, outb);
     if (rlatency != utime_t())
       osd->logger->tinc(l_osd_op_rw_rlat, rlatency);
   } else if (op->may_read()) {
@@ -2489,11 +2492,13 @@ void ReplicatedPG::log_op_stats(OpContext *ctx)
     osd->logger->inc(l_osd_op_r_outb, outb);
     osd->logger->tinc(l_osd_op_r_lat, latency);
     osd->logger->tinc(l_osd_op_r_process_lat, process_latency);
+    osd->logger->hinc(l_osd_op_r_lat_outb_hist, lat_usec, outb);
   } else if (op->may_write() || op->may_cache()) {
     osd->logger->inc(l_osd_op_w);
     osd->logger->inc(l_osd_op_w_inb, inb);
     osd->logger->tinc(l_osd_op_w_lat, latency);
     osd->logger->tinc(l_osd_op_w_process_lat, process_latency);
+    osd->logger->hinc(l_osd_op_w_lat_inb_hist, lat_usec, inb);
     if (rlatency != utime_t())
       osd->logger->tinc(l_osd_op_w_rlat, rlatency);
   } else
@@ -75,9 +75,24 @@ void Journaler::_set_layout(ceph_file_layout const *l)
   last_written.layout = layout;
   last_committed.layout = layout;
 
+  _update_fetch_len();
+}
+
+void Journaler::set_prefetch_periods(uint64_t periods)
+{
+  Mutex::Locker lk(lock);
+  ldout(cct, 10) << "set_prefetch_periods " << periods << dendl;
+  prefetch_periods = periods;
+  _update_fetch_len();
+}
+
+void Journaler::_update_fetch_len()
+{
   // prefetch intelligently.
   // (watch out, this is big if you use big objects or weird striping)
-  uint64_t periods = cct->_conf->journaler_prefetch_periods;
+  uint64_t periods = prefetch_periods;
+  if (!periods)
+    periods = cct->_conf->journaler_prefetch_periods;
   if (periods < 2)
     periods = 2;  // we need at least 2 periods to make progress.
   fetch_len = layout.fl_stripe_count * layout.fl_object_size * periods;
@@ -494,6 +509,12 @@ void Journaler::_finish_flush(int r, uint64_t start, utime_t stamp)
     finish_contexts(cct, waitfor_safe.begin()->second);
     waitfor_safe.erase(waitfor_safe.begin());
   }
+
+  // a write slot opened up; send everything batched behind it
+  if (group_commit_held && !_group_commit_should_hold()) {
+    ldout(cct, 20) << "_finish_flush issuing held group commit" << dendl;
+    _do_flush();
+  }
 }
 
 
@@ -608,6 +629,10 @@ void Journaler::_do_flush(unsigned amount)
 	      flush_pos, len, write_bl, ceph_clock_now(cct),
 	      0,
 	      NULL, wrap_finisher(onsafe));
+  if (write_buf.length() == 0)
+    group_commit_held = false;
+  if (logger && logger_key_batch >= 0)
+    logger->inc(logger_key_batch, len);
 
   flush_pos += len;
   assert(write_buf.length() == write_pos - flush_pos);
@@ -665,7 +690,23 @@ void Journaler::_flush(C_OnFinisher *onsafe)
     }
   } else {
     // maybe buffer
-    if (write_buf.length() < cct->_conf->journaler_batch_max) {
+    if (_group_commit_should_hold()) {
+      // enough writes in flight; batch this one with whatever arrives
+      // before one of them commits.
+      ldout(cct, 20) << "flush holding for group commit, "
+		     << pending_safe.size() << " writes in flight" << dendl;
+      if (!group_commit_held) {
+	group_commit_held = true;
+	group_commit_stamp = ceph_clock_now(cct);
+	// send it after journaler_group_commit_latency even if no write
+	// commits and no other flush comes along before then
+	if (!delay_flush_event) {
+	  delay_flush_event = new C_DelayFlush(this);
+	  timer->add_event_after(cct->_conf->journaler_group_commit_latency,
+				 delay_flush_event);
+	}
+      }
+    } else if (write_buf.length() < cct->_conf->journaler_batch_max) {
       // delay!  schedule an event.
       ldout(cct, 20) << "flush delaying flush" << dendl;
       if (delay_flush_event) {
@@ -687,6 +728,27 @@ void Journaler::_flush(C_OnFinisher *onsafe)
 }
 
 
+/*
+ * Hold a flush back if journaler_group_commit_inflight writes are
+ * already outstanding, unless the held data has been waiting longer
+ * than journaler_group_commit_latency.  Held data is always sent when
+ * an outstanding write commits (see _finish_flush).
+ */
+bool Journaler::_group_commit_should_hold()
+{
+  uint64_t max_inflight = cct->_conf->journaler_group_commit_inflight;
+  if (max_inflight == 0 || pending_safe.size() < max_inflight)
+    return false;
+  if (group_commit_held) {
+    utime_t held = ceph_clock_now(cct);
+    held -= group_commit_stamp;
+    if ((double)held >= cct->_conf->journaler_group_commit_latency)
+      return false;
+  }
+  return true;
+}
+
+
 /*************** prezeroing ******************/
 
 struct C_Journaler_Prezero : public Context {
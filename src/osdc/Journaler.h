@@ -217,6 +217,7 @@ private:
 
   PerfCounters *logger;
   int logger_key_lat;
+  int logger_key_batch;
 
   SafeTimer *timer;
 
@@ -299,6 +300,13 @@ private:
   std::set<uint64_t> pending_safe;
   std::map<uint64_t, std::list<Context*> > waitfor_safe; // when safe through given offset
 
+  // group commit: flushes requested while journaler_group_commit_inflight
+  // writes are outstanding are held and issued as one write when a
+  // write completes.
+  bool group_commit_held;
+  utime_t group_commit_stamp;  // when the oldest held flush was requested
+  bool _group_commit_should_hold();
+
   void _flush(C_OnFinisher *onsafe);
   void _do_flush(unsigned amount=0);
   void _finish_flush(int r, uint64_t start, utime_t stamp);
@@ -315,6 +323,8 @@ private:
 
   uint64_t fetch_len;     // how much to read at a time
   uint64_t temp_fetch_len;
+  uint64_t prefetch_periods;  // overrides journaler_prefetch_periods if set
+  void _update_fetch_len();
 
   // for wait_for_readable()
   C_OnFinisher    *on_readable;
@@ -370,7 +380,8 @@ private:
   C_OnFinisher *wrap_finisher(Context *c);
 
 public:
-  Journaler(inodeno_t ino_, int64_t pool, const char *mag, Objecter *obj, PerfCounters *l, int lkey, SafeTimer *tim, Finisher *f) : 
+  Journaler(inodeno_t ino_, int64_t pool, const char *mag, Objecter *obj,
+	    PerfCounters *l, int lkey, int lkey_batch, SafeTimer *tim, Finisher *f) :
     last_committed(mag),
     cct(obj->cct), lock("Journaler"), finisher(f),
     last_written(mag),
@@ -378,12 +389,13 @@ public:
     stream_format(-1), journal_stream(-1),
     magic(mag),
     objecter(obj), filer(objecter, f), logger(l), logger_key_lat(lkey),
+    logger_key_batch(lkey_batch),
     timer(tim), delay_flush_event(0),
     state(STATE_UNDEF), error(0),
     prezeroing_pos(0), prezero_pos(0), write_pos(0), flush_pos(0), safe_pos(0),
-    waiting_for_zero(false),
+    waiting_for_zero(false), group_commit_held(false),
     read_pos(0), requested_pos(0), received_pos(0),
-    fetch_len(0), temp_fetch_len(0),
+    fetch_len(0), temp_fetch_len(0), prefetch_periods(0),
     on_readable(0), on_write_error(NULL), called_write_error(false),
     expire_pos(0), trimming_pos(0), trimmed_pos(0)
   {
@@ -417,6 +429,7 @@ public:
     trimming_pos = 0;
     trimmed_pos = 0;
     waiting_for_zero = false;
+    group_commit_held = false;
   }
 
   // Asynchronous operations
@@ -434,6 +447,12 @@ public:
   // Synchronous setters
   // ===================
   void set_layout(ceph_file_layout const *l);
+  /**
+   * Read ahead this many layout periods instead of
+   * journaler_prefetch_periods, e.g. to keep more object reads in
+   * flight during replay.  0 restores the configured value.
+   */
+  void set_prefetch_periods(uint64_t periods);
   void set_readonly();
   void set_writeable();
   void set_write_pos(int64_t p) { 
@@ -11,9 +11,10 @@
 
 struct T : public Thread {
   int num;
+  bool fmt;
   set<int> myset;
   map<int,string> mymap;
-  T(int n) : num(n) {
+  T(int n, bool f) : num(n), fmt(f) {
     myset.insert(123);
     myset.insert(456);
     mymap[1] = "foo";
@@ -21,19 +22,33 @@ struct T : public Thread {
   }
 
   void *entry() {
-    while (num-- > 0)
-      generic_dout(0) << "this is a typical log line.  set "
-		      << myset << " and map " << mymap << dendl;
+    if (fmt) {
+      while (num-- > 0)
+	lgeneric_dout_fmt(g_ceph_context, 0,
+			  "this is a typical log line.  ints %d and %d, "
+			  "strings %s and %s") % 123 % 456 % "foo" % "bar"
+			  << dendl;
+    } else {
+      while (num-- > 0)
+	generic_dout(0) << "this is a typical log line.  set "
+			<< myset << " and map " << mymap << dendl;
+    }
     return 0;
   }
 };
 
 int main(int argc, const char **argv)
 {
+  if (argc < 3) {
+    cerr << "usage: " << argv[0] << " <threads> <lines> [fmt]" << std::endl;
+    return 1;
+  }
   int threads = atoi(argv[1]);
   int num = atoi(argv[2]);
+  bool fmt = argc > 3 && strcmp(argv[3], "fmt") == 0;
 
-  cout << threads << " threads, " << num << " lines per thread" << std::endl;
+  cout << threads << " threads, " << num << " lines per thread"
+       << (fmt ? ", deferred formatting" : "") << std::endl;
 
   vector<const char*> args;
   argv_to_vec(argc, argv, args);
@@ -45,7 +60,7 @@ int main(int argc, const char **argv)
 
   list<T*> ls;
   for (int i=0; i<threads; i++) {
-    T *t = new T(num);
+    T *t = new T(num, fmt);
     t->create();
     ls.push_back(t);
   }
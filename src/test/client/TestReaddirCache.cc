@@ -0,0 +1,94 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#include <algorithm>
+#include <vector>
+
+#include "client/Client.h"
+
+#include "gtest/gtest.h"
+
+typedef pair<uint64_t, Dentry*> entry_t;
+
+/*
+ * the leaves of a directory fragmented to different depths, in the
+ * order readdir visits them: 0 split into 000..011, then 1.
+ */
+static void make_leaves(vector<frag_t> *leaves)
+{
+  frag_t root;
+  frag_t left = root.left_child();
+  for (int i = 0; i < 4; ++i)
+    leaves->push_back(left.make_child(i, 2));
+  leaves->push_back(root.right_child());
+}
+
+static void make_positions(vector<entry_t> *ls)
+{
+  vector<frag_t> leaves;
+  make_leaves(&leaves);
+  for (unsigned i = 0; i < leaves.size(); ++i)
+    for (unsigned off = 2; off < 5; ++off)
+      ls->push_back(make_pair(dir_result_t::make_fpos(leaves[i], off),
+			      (Dentry*)NULL));
+}
+
+TEST(ReaddirCache, RawOrderIsNotReaddirOrder)
+{
+  vector<entry_t> ls;
+  make_positions(&ls);
+  // the deeper frags sort after the shallow one by raw value, which
+  // is why the cache can't simply compare offsets.
+  bool increasing = true;
+  for (unsigned i = 1; i < ls.size(); ++i)
+    if (ls[i].first <= ls[i - 1].first)
+      increasing = false;
+  ASSERT_FALSE(increasing);
+}
+
+TEST(ReaddirCache, SortsInReaddirOrder)
+{
+  vector<entry_t> expect;
+  make_positions(&expect);
+
+  vector<entry_t> ls = expect;
+  std::reverse(ls.begin(), ls.end());
+  std::sort(ls.begin(), ls.end(), dir_result_t::fpos_less());
+  ASSERT_EQ(expect.size(), ls.size());
+  for (unsigned i = 0; i < ls.size(); ++i) {
+    ASSERT_EQ(expect[i].first, ls[i].first);
+    if (i)
+      ASSERT_LT(dir_result_t::fpos_cmp(ls[i - 1].first, ls[i].first), 0);
+  }
+}
+
+TEST(ReaddirCache, SeekAcrossFrags)
+{
+  vector<entry_t> ls;
+  make_positions(&ls);
+
+  // resuming after the last entry of a frag lands on the first entry
+  // of the next one
+  for (unsigned i = 0; i + 1 < ls.size(); ++i) {
+    vector<entry_t>::iterator p =
+      lower_bound(ls.begin(), ls.end(),
+		  make_pair(ls[i].first + 1, (Dentry*)NULL),
+		  dir_result_t::fpos_less());
+    ASSERT_TRUE(p != ls.end());
+    ASSERT_EQ(ls[i + 1].first, p->first);
+  }
+  vector<entry_t>::iterator p =
+    lower_bound(ls.begin(), ls.end(),
+		make_pair(ls.back().first + 1, (Dentry*)NULL),
+		dir_result_t::fpos_less());
+  ASSERT_TRUE(p == ls.end());
+}
@@ -0,0 +1,153 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+#include <map>
+#include <vector>
+#include "common/Finisher.h"
+#include "common/Mutex.h"
+#include "common/Thread.h"
+#include "common/ceph_argparse.h"
+#include "global/global_init.h"
+#include "global/global_context.h"
+#include <gtest/gtest.h>
+
+/// record (key, seq, r) as it completes
+struct Recorder {
+  Mutex lock;
+  map<int, vector<int> > seen;
+  int total;
+  Recorder() : lock("Recorder::lock"), total(0) {}
+};
+
+class C_Record : public Context {
+  Recorder *rec;
+  int key, seq;
+public:
+  C_Record(Recorder *rec, int key, int seq) : rec(rec), key(key), seq(seq) {}
+  void finish(int r) {
+    Mutex::Locker l(rec->lock);
+    rec->seen[key].push_back(seq + r);
+    rec->total++;
+  }
+};
+
+TEST(Finisher, InOrder) {
+  Finisher finisher(g_ceph_context, "test_in_order");
+  finisher.start();
+  Recorder rec;
+  for (int i = 0; i < 1000; ++i) {
+    if (i % 3 == 0) {
+      finisher.queue(new C_Record(&rec, 0, i - 1), 1);
+    } else if (i % 3 == 1) {
+      finisher.queue(new C_Record(&rec, 0, i));
+    } else {
+      list<Context*> ls;
+      ls.push_back(new C_Record(&rec, 0, i));
+      finisher.queue(ls);
+      ASSERT_TRUE(ls.empty());
+    }
+  }
+  finisher.wait_for_empty();
+  ASSERT_EQ(1000, rec.total);
+  for (int i = 0; i < 1000; ++i)
+    ASSERT_EQ(i, rec.seen[0][i]);
+  finisher.stop();
+}
+
+class Producer : public Thread {
+  Finisher *finisher;
+  Recorder *rec;
+  int first_key, num_keys, count;
+public:
+  Producer(Finisher *f, Recorder *rec, int first_key, int num_keys, int count)
+    : finisher(f), rec(rec), first_key(first_key), num_keys(num_keys),
+      count(count) {}
+  void *entry() {
+    for (int i = 0; i < count; ++i) {
+      int key = first_key + i % num_keys;
+      finisher->queue_ordered(key, new C_Record(rec, key, i));
+    }
+    return NULL;
+  }
+};
+
+TEST(Finisher, OrderedKeys) {
+  Finisher finisher(g_ceph_context, "test_ordered", 4);
+  finisher.start();
+  Recorder rec;
+  vector<Producer*> producers;
+  for (int i = 0; i < 4; ++i) {
+    producers.push_back(new Producer(&finisher, &rec, i * 10, 5, 2000));
+    producers.back()->create();
+  }
+  for (int i = 0; i < 4; ++i) {
+    producers[i]->join();
+    delete producers[i];
+  }
+  finisher.wait_for_empty();
+  ASSERT_EQ(8000, rec.total);
+  ASSERT_EQ(20u, rec.seen.size());
+  for (map<int, vector<int> >::iterator p = rec.seen.begin();
+       p != rec.seen.end();
+       ++p) {
+    ASSERT_EQ(400u, p->second.size());
+    for (unsigned i = 1; i < p->second.size(); ++i)
+      ASSERT_LT(p->second[i - 1], p->second[i]);
+  }
+  finisher.stop();
+}
+
+TEST(Finisher, ManyThreads) {
+  Finisher finisher(g_ceph_context, "test_many", 3);
+  finisher.start();
+  Recorder rec;
+  for (int i = 0; i < 300; ++i) {
+    vector<Context*> ls;
+    for (int j = 0; j < 10; ++j)
+      ls.push_back(new C_Record(&rec, j, i));
+    finisher.queue(ls);
+  }
+  finisher.wait_for_empty();
+  ASSERT_EQ(3000, rec.total);
+  finisher.stop();
+
+  // restart after stop
+  finisher.start();
+  finisher.queue(new C_Record(&rec, 0, 0));
+  finisher.wait_for_empty();
+  ASSERT_EQ(3001, rec.total);
+  finisher.stop();
+}
+
+TEST(Finisher, QueueAfterStop) {
+  Recorder rec;
+  {
+    Finisher finisher(g_ceph_context, "test_after_stop", 2);
+    finisher.start();
+    finisher.stop();
+    // never run, and dropped when the finisher goes away
+    finisher.queue(new C_Record(&rec, 0, 0));
+    finisher.queue_ordered(1, new C_Record(&rec, 1, 0));
+  }
+  ASSERT_EQ(0, rec.total);
+}
+
+int main(int argc, char **argv) {
+  vector<const char*> args;
+  argv_to_vec(argc, (const char **)argv, args);
+
+  global_init(NULL, args, CEPH_ENTITY_TYPE_CLIENT, CODE_ENVIRONMENT_UTILITY, 0);
+  common_init_finish(g_ceph_context);
+
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
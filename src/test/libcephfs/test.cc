@@ -21,6 +21,8 @@
 #include <sys/stat.h>
 #include <dirent.h>
 #include <sys/xattr.h>
+#include <set>
+#include <string>
 
 #ifdef __linux__
 #include <limits.h>
@@ -380,6 +382,94 @@ TEST(LibCephFS, DirLs) {
   ceph_shutdown(cmount);
 }
 
+TEST(LibCephFS, DirLsCachedUnlink) {
+  struct ceph_mount_info *cmount;
+  ASSERT_EQ(ceph_create(&cmount, NULL), 0);
+  ASSERT_EQ(0, ceph_conf_parse_env(cmount, NULL));
+  ASSERT_EQ(ceph_conf_read_file(cmount, NULL), 0);
+  ASSERT_EQ(ceph_mount(cmount, "/"), 0);
+
+  char dir[256];
+  sprintf(dir, "dir_ls_cached%d", getpid());
+  ASSERT_EQ(ceph_mkdir(cmount, dir, 0777), 0);
+
+  const int n = 100;
+  char path[512];
+  for (int i = 0; i < n; ++i) {
+    sprintf(path, "%s/f%d", dir, i);
+    int fd = ceph_open(cmount, path, O_CREAT|O_RDONLY, 0666);
+    ASSERT_GT(fd, 0);
+    ASSERT_EQ(ceph_close(cmount, fd), 0);
+  }
+
+  // the first pass fills the cache, the rest should be served from it
+  for (int pass = 0; pass < 3; ++pass) {
+    struct ceph_dir_result *ls_dir = NULL;
+    ASSERT_EQ(ceph_opendir(cmount, dir, &ls_dir), 0);
+    std::set<std::string> seen;
+    struct dirent *de;
+    while ((de = ceph_readdir(cmount, ls_dir)) != NULL) {
+      if (strcmp(de->d_name, ".") && strcmp(de->d_name, ".."))
+	ASSERT_TRUE(seen.insert(de->d_name).second);
+    }
+    ASSERT_EQ(ceph_closedir(cmount, ls_dir), 0);
+
+    int expect = n - (pass ? 10 * pass : 0);
+    ASSERT_EQ(expect, (int)seen.size());
+
+    // drop a few entries; they must not show up in the next listing
+    for (int i = pass * 10; i < (pass + 1) * 10; ++i) {
+      sprintf(path, "%s/f%d", dir, i);
+      ASSERT_EQ(0, ceph_unlink(cmount, path));
+    }
+  }
+
+  ceph_shutdown(cmount);
+}
+
+TEST(LibCephFS, AsyncUnlink) {
+  struct ceph_mount_info *cmount;
+  ASSERT_EQ(ceph_create(&cmount, NULL), 0);
+  ASSERT_EQ(0, ceph_conf_parse_env(cmount, NULL));
+  ASSERT_EQ(ceph_conf_read_file(cmount, NULL), 0);
+  ASSERT_EQ(ceph_conf_set(cmount, "client_async_unlink", "true"), 0);
+  ASSERT_EQ(ceph_mount(cmount, "/"), 0);
+
+  char dir[256];
+  sprintf(dir, "async_unlink%d", getpid());
+  ASSERT_EQ(ceph_mkdir(cmount, dir, 0777), 0);
+
+  const int n = 200;
+  char path[512];
+  for (int i = 0; i < n; ++i) {
+    sprintf(path, "%s/f%d", dir, i);
+    int fd = ceph_open(cmount, path, O_CREAT|O_RDONLY, 0666);
+    ASSERT_GT(fd, 0);
+    ASSERT_EQ(ceph_close(cmount, fd), 0);
+  }
+
+  for (int i = 0; i < n; ++i) {
+    sprintf(path, "%s/f%d", dir, i);
+    ASSERT_EQ(0, ceph_unlink(cmount, path));
+    struct stat st;
+    ASSERT_EQ(-ENOENT, ceph_stat(cmount, path, &st));
+  }
+
+  // closedir reports any background unlink failure
+  struct ceph_dir_result *ls_dir = NULL;
+  ASSERT_EQ(ceph_opendir(cmount, dir, &ls_dir), 0);
+  struct dirent *de;
+  while ((de = ceph_readdir(cmount, ls_dir)) != NULL) {
+    ASSERT_TRUE(!strcmp(de->d_name, ".") || !strcmp(de->d_name, ".."));
+  }
+  ASSERT_EQ(ceph_closedir(cmount, ls_dir), 0);
+
+  // rmdir has to wait for the unlinks to land
+  ASSERT_EQ(ceph_rmdir(cmount, dir), 0);
+
+  ceph_shutdown(cmount);
+}
+
 TEST(LibCephFS, ManyNestedDirs) {
   struct ceph_mount_info *cmount;
   ASSERT_EQ(ceph_create(&cmount, NULL), 0);
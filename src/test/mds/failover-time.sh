@@ -0,0 +1,71 @@
+#!/bin/bash
+#
+# Copyright (C) 2015 Red Hat <contact@redhat.com>
+#
+# This program is free software; you can redistribute it and/or modify
+# it under the terms of the GNU Library Public License as published by
+# the Free Software Foundation; either version 2, or (at your option)
+# any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU Library Public License for more details.
+#
+# Measure how long a standby-replay MDS takes to become active after
+# the active MDS it follows is failed.  Run from src/:
+#
+#   test/mds/failover-time.sh [files]
+#
+# A vstart cluster with one active and one standby-replay MDS is
+# started, ceph-syn creates metadata load, rank 0 is failed and the
+# time until it is up:active again is printed.
+#
+
+if [ "$1" != "--inside" ] ; then
+    MDS=1 MON=1 OSD=3 CEPH_START='mon osd mds' CEPH_PORT=7210 \
+        VSTART_ARGS=-s exec test/vstart_wrapper.sh $0 --inside "$@"
+fi
+shift
+
+FILES=${1:-10000}
+TIMEOUT=300
+
+function now() {
+    date +%s.%N
+}
+
+function wait_for_active() {
+    local name=$1
+    local start=$2
+    while true ; do
+        if ceph mds stat 2>/dev/null | grep -q "0=$name=up:active" ; then
+            return 0
+        fi
+        if [ $(echo "$(now) - $start > $TIMEOUT" | bc) -eq 1 ] ; then
+            return 1
+        fi
+        sleep 0.1
+    done
+}
+
+wait_for_active a $(now) || exit 1
+
+# journal some metadata load so the standby has something to follow
+ceph-syn --num_client 1 --syn mdtest $FILES 1 || exit 1
+ceph-syn --num_client 1 --syn makedirs 10 $(($FILES / 100)) 2 || exit 1
+
+# give the standby a moment to catch up on the tail of the journal
+sleep 2
+ceph mds stat
+
+start=$(now)
+ceph mds fail 0 || exit 1
+if ! wait_for_active as $start ; then
+    echo "mds did not become active within $TIMEOUT seconds"
+    exit 1
+fi
+end=$(now)
+
+ceph mds stat
+echo "failover time: $(echo "$end - $start" | bc) seconds"
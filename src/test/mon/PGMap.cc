@@ -83,6 +83,61 @@ TEST(pgmap, min_last_epoch_clean)
 
 
 
+TEST(pgmap, unhealthy_pgs)
+{
+  PGMap pg_map;
+  PGMap::Incremental inc;
+  pg_stat_t ps;
+
+  ps.state = PG_STATE_ACTIVE | PG_STATE_CLEAN;
+  inc.version = 1;
+  inc.pg_stat_updates[pg_t(3,1)] = ps;
+  inc.pg_stat_updates[pg_t(1,1)] = ps;
+  ps.state = PG_STATE_PEERING;
+  inc.pg_stat_updates[pg_t(2,1)] = ps;
+  pg_map.apply_incremental(g_ceph_context, inc);
+  ASSERT_EQ(1u, pg_map.unhealthy_pgs.size());
+  ASSERT_EQ(1u, pg_map.unhealthy_pgs.count(pg_t(2,1)));
+
+  // clean pg picks up a flag health cares about
+  inc = PGMap::Incremental();
+  inc.version = 2;
+  ps.state = PG_STATE_ACTIVE | PG_STATE_CLEAN | PG_STATE_INCONSISTENT;
+  inc.pg_stat_updates[pg_t(3,1)] = ps;
+  ps.state = PG_STATE_ACTIVE | PG_STATE_CLEAN;
+  inc.pg_stat_updates[pg_t(2,1)] = ps;
+  pg_map.apply_incremental(g_ceph_context, inc);
+  ASSERT_EQ(1u, pg_map.unhealthy_pgs.size());
+  ASSERT_EQ(1u, pg_map.unhealthy_pgs.count(pg_t(3,1)));
+
+  // only unhealthy pgs can be stuck
+  ceph::unordered_map<pg_t, pg_stat_t> stuck;
+  pg_map.get_stuck_stats(PGMap::STUCK_UNCLEAN, ceph_clock_now(NULL), stuck);
+  ASSERT_TRUE(stuck.empty());
+
+  inc = PGMap::Incremental();
+  inc.version = 3;
+  inc.pg_remove.insert(pg_t(3,1));
+  pg_map.apply_incremental(g_ceph_context, inc);
+  ASSERT_TRUE(pg_map.unhealthy_pgs.empty());
+
+  // a decoded map rebuilds the set
+  ps.state = PG_STATE_STALE | PG_STATE_ACTIVE | PG_STATE_CLEAN;
+  inc = PGMap::Incremental();
+  inc.version = 4;
+  inc.pg_stat_updates[pg_t(1,1)] = ps;
+  pg_map.apply_incremental(g_ceph_context, inc);
+  bufferlist bl;
+  pg_map.encode(bl);
+  PGMap copy;
+  bufferlist::iterator p = bl.begin();
+  copy.decode(p);
+  ASSERT_EQ(1u, copy.unhealthy_pgs.count(pg_t(1,1)));
+  stuck.clear();
+  copy.get_stuck_stats(PGMap::STUCK_STALE, ceph_clock_now(NULL), stuck);
+  ASSERT_EQ(1u, stuck.size());
+}
+
 int main(int argc, char **argv) {
   vector<const char*> args;
   argv_to_vec(argc, (const char **)argv, args);
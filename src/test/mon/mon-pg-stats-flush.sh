@@ -0,0 +1,72 @@
+#!/bin/bash
+#
+# Copyright (C) 2014 Red Hat <contact@redhat.com>
+#
+# This program is free software; you can redistribute it and/or modify
+# it under the terms of the GNU Library Public License as published by
+# the Free Software Foundation; either version 2, or (at your option)
+# any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU Library Public License for more details.
+#
+source test/mon/mon-test-helpers.sh
+source test/osd/osd-test-helpers.sh
+
+function get_objects() {
+    ./ceph df | awk '$1 == "rbd" { print $NF }'
+}
+
+function run() {
+    local dir=$1
+
+    PORT=7310 # CEPH_MON=
+    MONA=127.0.0.1:$PORT
+    MONB=127.0.0.1:$(($PORT + 1))
+    MONC=127.0.0.1:$(($PORT + 2))
+    export CEPH_ARGS
+    CEPH_ARGS+="--fsid=$(uuidgen) --auth-supported=none "
+    CEPH_ARGS+="--mon-initial-members=a,b,c --mon-host=$MONA,$MONB,$MONC "
+    # long enough that only an election can come between the ack and the flush
+    CEPH_ARGS+="--mon-pg-stats-flush-interval=600 "
+    run_mon $dir a --public-addr $MONA || return 1
+    run_mon $dir b --public-addr $MONB || return 1
+    run_mon $dir c --public-addr $MONC || return 1
+    timeout 360 ./ceph mon stat || return 1
+    ./ceph --admin-daemon $dir/a/ceph-mon.a.asok mon_status |
+       grep '"leader"' || return 1
+
+    run_osd $dir 0 || return 1
+    ./ceph osd pool set rbd size 1 || return 1
+    # pg state changes are committed right away
+    for ((i=0; i < 120; i++)) ; do
+        ./ceph pg stat | grep -q 'pgs: [0-9]* active+clean;' && break
+        sleep 1
+    done
+    ./ceph pg stat | grep -q 'pgs: [0-9]* active+clean;' || return 1
+
+    for i in $(seq 10) ; do
+        ./rados --pool rbd put obj$i /etc/group || return 1
+    done
+    # give the osd time to report, the leader holds the stats (and the ack)
+    sleep 10
+    test "$(get_objects)" = 0 || return 1
+
+    # the election drops the unflushed stats on the leader; the osd was
+    # never acked and must report them again to the new leader
+    kill_daemons $dir/a
+    timeout 360 ./ceph mon stat || return 1
+    for ((i=0; i < 60; i++)) ; do
+        test "$(get_objects)" = 10 && break
+        sleep 1
+    done
+    test "$(get_objects)" = 10 || return 1
+}
+
+main mon-pg-stats-flush
+
+# Local Variables:
+# compile-command: "cd ../.. ; make TESTS=test/mon/mon-pg-stats-flush.sh check"
+# End:
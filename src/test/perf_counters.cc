@@ -187,3 +187,147 @@ TEST(PerfCounters, MultiplePerfCounters) {
   ASSERT_EQ("", client.do_request("{ \"prefix\": \"perf dump\", \"format\": \"json\" }", &msg));
   ASSERT_EQ("{}", msg);
 }
+
+enum {
+  TEST_PERFCOUNTERS3_ELEMENT_FIRST = 600,
+  TEST_PERFCOUNTERS3_ELEMENT_COUNT,
+  TEST_PERFCOUNTERS3_ELEMENT_LAT,
+  TEST_PERFCOUNTERS3_ELEMENT_LAST,
+};
+
+static PerfCounters* setup_test_perfcounter3(CephContext *cct)
+{
+  PerfCountersBuilder bld(cct, "test_perfcounter_3",
+	  TEST_PERFCOUNTERS3_ELEMENT_FIRST, TEST_PERFCOUNTERS3_ELEMENT_LAST);
+  bld.add_u64_counter(TEST_PERFCOUNTERS3_ELEMENT_COUNT, "count");
+  bld.add_time_hist(TEST_PERFCOUNTERS3_ELEMENT_LAT, "lat");
+  return bld.create_perf_counters();
+}
+
+TEST(PerfCounters, Histogram) {
+  PerfCountersCollection *coll = g_ceph_context->get_perfcounters_collection();
+  coll->clear();
+  PerfCounters* fake_pf = setup_test_perfcounter3(g_ceph_context);
+  coll->add(fake_pf);
+  AdminSocketClient client(get_rand_socket_path());
+  std::string msg;
+
+  ASSERT_EQ("", client.do_request("{ \"prefix\": \"perf dump\", \"format\": \"json\" }", &msg));
+  ASSERT_EQ(sd("{\"test_perfcounter_3\":{\"count\":0,\"lat\":{\"avgcount\":0,"
+	    "\"sum\":0.000000000,\"histogram\":{\"buckets\":[]}}}}"), msg);
+
+  for (int i = 0; i < 9; ++i)
+    fake_pf->tinc(TEST_PERFCOUNTERS3_ELEMENT_LAT, utime_t(0, 1000));
+  fake_pf->tinc(TEST_PERFCOUNTERS3_ELEMENT_LAT, utime_t(1, 0));
+  std::vector<uint64_t> counts;
+  fake_pf->get_histogram(TEST_PERFCOUNTERS3_ELEMENT_LAT, &counts);
+  ASSERT_EQ((unsigned)PerfCounters::HISTOGRAM_BUCKETS, counts.size());
+  ASSERT_EQ(9u, counts[10]);
+  ASSERT_EQ(1u, counts[30]);
+
+  ASSERT_EQ("", client.do_request("{ \"prefix\": \"perf dump\", \"format\": \"json\" }", &msg));
+  ASSERT_EQ(sd("{\"test_perfcounter_3\":{\"count\":0,\"lat\":{\"avgcount\":10,"
+	    "\"sum\":1.000009000,\"histogram\":{\"p50\":0.000001023,"
+	    "\"p90\":0.000001023,\"p99\":1.073741823,\"p999\":1.073741823,"
+	    "\"buckets\":[{\"max\":0.000001023,\"count\":9},"
+	    "{\"max\":1.073741823,\"count\":1}]}}}}"), msg);
+
+  fake_pf->reset();
+  ASSERT_EQ("", client.do_request("{ \"prefix\": \"perf dump\", \"format\": \"json\" }", &msg));
+  ASSERT_EQ(sd("{\"test_perfcounter_3\":{\"count\":0,\"lat\":{\"avgcount\":0,"
+	    "\"sum\":0.000000000,\"histogram\":{\"buckets\":[]}}}}"), msg);
+  coll->clear();
+}
+
+TEST(PerfCounters, Sharded) {
+  g_ceph_context->_conf->set_val("perf_shards", "4");
+  g_ceph_context->_conf->apply_changes(NULL);
+  PerfCountersCollection *coll = g_ceph_context->get_perfcounters_collection();
+  coll->clear();
+  PerfCounters* fake_pf = setup_test_perfcounter3(g_ceph_context);
+  coll->add(fake_pf);
+  AdminSocketClient client(get_rand_socket_path());
+  std::string msg;
+
+  for (int i = 0; i < 100; ++i) {
+    fake_pf->inc(TEST_PERFCOUNTERS3_ELEMENT_COUNT);
+    fake_pf->tinc(TEST_PERFCOUNTERS3_ELEMENT_LAT, utime_t(0, 1000));
+  }
+  ASSERT_EQ(100u, fake_pf->get(TEST_PERFCOUNTERS3_ELEMENT_COUNT));
+  ASSERT_EQ(make_pair((uint64_t)100, (uint64_t)0),
+	    fake_pf->get_tavg_ms(TEST_PERFCOUNTERS3_ELEMENT_LAT));
+  ASSERT_EQ("", client.do_request("{ \"prefix\": \"perf dump\", \"format\": \"json\" }", &msg));
+  ASSERT_EQ(sd("{\"test_perfcounter_3\":{\"count\":100,\"lat\":{\"avgcount\":100,"
+	    "\"sum\":0.000100000,\"histogram\":{\"p50\":0.000001023,"
+	    "\"p90\":0.000001023,\"p99\":0.000001023,\"p999\":0.000001023,"
+	    "\"buckets\":[{\"max\":0.000001023,\"count\":100}]}}}}"), msg);
+
+  fake_pf->set(TEST_PERFCOUNTERS3_ELEMENT_COUNT, 7);
+  ASSERT_EQ(7u, fake_pf->get(TEST_PERFCOUNTERS3_ELEMENT_COUNT));
+  fake_pf->reset();
+  ASSERT_EQ(0u, fake_pf->get(TEST_PERFCOUNTERS3_ELEMENT_COUNT));
+  ASSERT_EQ(make_pair((uint64_t)0, (uint64_t)0),
+	    fake_pf->get_tavg_ms(TEST_PERFCOUNTERS3_ELEMENT_LAT));
+
+  coll->clear();
+  g_ceph_context->_conf->set_val("perf_shards", "0");
+  g_ceph_context->_conf->apply_changes(NULL);
+}
+
+enum {
+  TEST_PERFCOUNTERS4_ELEMENT_FIRST = 800,
+  TEST_PERFCOUNTERS4_ELEMENT_COUNT,
+  TEST_PERFCOUNTERS4_ELEMENT_HIST,
+  TEST_PERFCOUNTERS4_ELEMENT_LAST,
+};
+
+static PerfCounters* setup_test_perfcounter4(CephContext *cct)
+{
+  PerfCountersBuilder bld(cct, "test_perfcounter_4",
+	  TEST_PERFCOUNTERS4_ELEMENT_FIRST, TEST_PERFCOUNTERS4_ELEMENT_LAST);
+  bld.add_u64_counter(TEST_PERFCOUNTERS4_ELEMENT_COUNT, "count");
+  perf_histogram_axis_d x = {
+    "x", perf_histogram_axis_d::SCALE_LINEAR, 0, 10, 4
+  };
+  perf_histogram_axis_d y = {
+    "y", perf_histogram_axis_d::SCALE_LOG2, 1, 1, 4
+  };
+  bld.add_histogram_2d(TEST_PERFCOUNTERS4_ELEMENT_HIST, "h", x, y);
+  return bld.create_perf_counters();
+}
+
+TEST(PerfCounters, Histogram2D) {
+  PerfCountersCollection *coll = g_ceph_context->get_perfcounters_collection();
+  coll->clear();
+  PerfCounters* fake_pf = setup_test_perfcounter4(g_ceph_context);
+  coll->add(fake_pf);
+  AdminSocketClient client(get_rand_socket_path());
+  std::string msg;
+
+  // the histogram is only in the histogram dump
+  ASSERT_EQ("", client.do_request("{ \"prefix\": \"perf dump\", \"format\": \"json\" }", &msg));
+  ASSERT_EQ(sd("{\"test_perfcounter_4\":{\"count\":0}}"), msg);
+  ASSERT_EQ("", client.do_request("{ \"prefix\": \"perf histogram schema\", \"format\": \"json\" }", &msg));
+  ASSERT_EQ(sd("{\"test_perfcounter_4\":{\"h\":{\"type\":34,\"description\":\"\",\"nick\":\"\","
+	    "\"axes\":[{\"name\":\"x\",\"scale\":\"linear\",\"min\":0,\"quant_size\":10,"
+	    "\"buckets\":4,\"ranges\":[{\"max\":-1},{\"min\":0,\"max\":9},"
+	    "{\"min\":10,\"max\":19},{\"min\":20}]},"
+	    "{\"name\":\"y\",\"scale\":\"log2\",\"min\":1,\"quant_size\":1,"
+	    "\"buckets\":4,\"ranges\":[{\"max\":0},{\"min\":1,\"max\":1},"
+	    "{\"min\":2,\"max\":2},{\"min\":3}]}]}}}"), msg);
+
+  fake_pf->hinc(TEST_PERFCOUNTERS4_ELEMENT_HIST, -1, 0);
+  fake_pf->hinc(TEST_PERFCOUNTERS4_ELEMENT_HIST, 5, 1);
+  fake_pf->hinc(TEST_PERFCOUNTERS4_ELEMENT_HIST, 15, 3);
+  fake_pf->hinc(TEST_PERFCOUNTERS4_ELEMENT_HIST, 15, 2);
+  fake_pf->hinc(TEST_PERFCOUNTERS4_ELEMENT_HIST, 100, 100);
+  ASSERT_EQ("", client.do_request("{ \"prefix\": \"perf histogram dump\", \"format\": \"json\" }", &msg));
+  ASSERT_EQ(sd("{\"test_perfcounter_4\":{\"h\":{\"values\":"
+	    "[[1,0,0,0],[0,1,0,0],[0,0,1,1],[0,0,0,1]]}}}"), msg);
+
+  ASSERT_EQ("", client.do_request("{ \"prefix\": \"perf reset\", \"var\": \"test_perfcounter_4\" }", &msg));
+  ASSERT_EQ("", client.do_request("{ \"prefix\": \"perf histogram dump\", \"format\": \"json\" }", &msg));
+  ASSERT_EQ(sd("{\"test_perfcounter_4\":{\"h\":{\"values\":"
+	    "[[0,0,0,0],[0,0,0,0],[0,0,0,0],[0,0,0,0]]}}}"), msg);
+  coll->clear();
+}
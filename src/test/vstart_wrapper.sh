@@ -30,7 +30,7 @@ function vstart_setup()
     export PATH=.:$PATH
     ./vstart.sh \
         -o 'paxos propose interval = 0.01' \
-        -n -l $CEPH_START || return 1
+        -n -l $VSTART_ARGS $CEPH_START || return 1
     export CEPH_CONF=$CEPH_DIR/ceph.conf
 
     crit=$(expr 100 - $(ceph-conf --show-config-value mon_data_avail_crit))
@@ -0,0 +1,126 @@
+// -*- mode:C++; tab-width:8; c-basic-offset:2; indent-tabs-mode:t -*-
+// vim: ts=8 sw=2 smarttab
+/*
+ * Ceph - scalable distributed file system
+ *
+ * This is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License version 2.1, as published by the Free Software
+ * Foundation.  See file COPYING.
+ *
+ */
+
+/*
+ * print a log file written with log_binary = true as text, in the same
+ * layout as a regular log file.  plain text lines (e.g., crash dumps)
+ * are passed through unchanged.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <iostream>
+#include <string>
+
+#include "log/Entry.h"
+#include "common/errno.h"
+#include "common/safe_io.h"
+
+using ceph::log::Entry;
+
+static void usage()
+{
+  std::cerr << "usage: ceph-log-decode [<log file>]" << std::endl
+	    << "  reads stdin if no file is given" << std::endl;
+}
+
+static void print_record(const utime_t& stamp, uint64_t thread, short prio,
+			 const std::string& text)
+{
+  char buf[80];
+  int buflen = stamp.sprintf(buf, sizeof(buf));
+  snprintf(buf + buflen, sizeof(buf) - buflen, " %lx %2d ",
+	   (unsigned long)thread, prio);
+  std::cout << buf << text << "\n";
+}
+
+int main(int argc, const char **argv)
+{
+  int fd = 0;
+  if (argc > 2 || (argc == 2 && (strcmp(argv[1], "-h") == 0 ||
+				 strcmp(argv[1], "--help") == 0))) {
+    usage();
+    return 1;
+  }
+  if (argc == 2) {
+    fd = ::open(argv[1], O_RDONLY);
+    if (fd < 0) {
+      int r = errno;
+      std::cerr << "unable to open " << argv[1] << ": "
+		<< cpp_strerror(r) << std::endl;
+      return 1;
+    }
+  }
+
+  std::string data;
+  char buf[65536];
+  size_t pos = 0;
+  bool eof = false;
+  while (true) {
+    if (!eof) {
+      ssize_t r = safe_read(fd, buf, sizeof(buf));
+      if (r < 0) {
+	std::cerr << "read error: " << cpp_strerror(r) << std::endl;
+	return 1;
+      }
+      if (r == 0)
+	eof = true;
+      else
+	data.append(buf, r);
+    }
+
+    while (pos < data.size()) {
+      utime_t stamp;
+      uint64_t thread;
+      short prio, subsys;
+      std::string text;
+      int r = Entry::decode_binary(data.data() + pos, data.size() - pos,
+				   &stamp, &thread, &prio, &subsys, &text);
+      if (r > 0) {
+	print_record(stamp, thread, prio, text);
+	pos += r;
+	continue;
+      }
+      if (r == 0)
+	break;  // need more data
+
+      // not a record: pass a text line through
+      size_t nl = data.find('\n', pos);
+      if (nl == std::string::npos) {
+	if (!eof)
+	  break;
+	nl = data.size() - 1;
+      }
+      std::cout.write(data.data() + pos, nl + 1 - pos);
+      pos = nl + 1;
+    }
+
+    // drop what we have consumed
+    data.erase(0, pos);
+    pos = 0;
+    if (eof && data.empty())
+      break;
+    if (eof) {
+      // a truncated record at the end of the file
+      std::cerr << "ignoring " << data.size() << " trailing bytes" << std::endl;
+      break;
+    }
+  }
+  std::cout.flush();
+  if (fd > 0)
+    ::close(fd);
+  return 0;
+}
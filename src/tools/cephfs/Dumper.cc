@@ -74,7 +74,7 @@ int Dumper::dump(const char *dump_file)
   int r = 0;
 
   Journaler journaler(ino, mdsmap->get_metadata_pool(), CEPH_FS_ONDISK_MAGIC,
-                                       objecter, 0, 0, &timer, &finisher);
+                                       objecter, 0, 0, 0, &timer, &finisher);
   r = recover_journal(&journaler);
   if (r) {
     return r;